@@ -0,0 +1,79 @@
+
+//===----------------------------------------------------------------------===//
+//
+// BinaryNet
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef MRPH_BINARY_NET_H
+#define MRPH_BINARY_NET_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "morpheus/ADT/FrozenNet.hpp"
+
+#include <cstdint>
+
+namespace cn {
+using namespace llvm;
+
+// The binary format of nets stores a FrozenNet, hence a loaded net is thawed
+// to be modified. The file starts with a fixed header:
+//
+//   char magic[8]     "MRPHNET\0"
+//   u32  version
+//   u32  number of sections
+//   { u32 kind, u32 reserved, u64 offset, u64 size }[number of sections]
+//
+// All the fixed-width numbers are little-endian and the offsets are relative
+// to the start of the file, so a tool mapping the file reads only the
+// sections it needs. The sections are:
+//
+//   META      ULEB128: ID, embedded ID, address, end of interface places,
+//             end of places, nodes, edges, asr, arr, csr, crr, entry + 1
+//             and exit + 1 (0 if the place is gone)
+//   STRINGS   u32 count, u32 offsets[count + 1] into the bytes that follow,
+//             the string 0 is the empty one (the null symbol)
+//   NODES     per node ULEB128: ID, name; place: type, init expression;
+//             transition: size of guard and its conditions
+//   EDGES     per node and category ULEB128: number of outgoing edges, then
+//             per edge: zigzag(endpoint - startpoint), arc expression, type
+//   INCOMING  per node ULEB128: number of incoming edges, then zigzag deltas
+//             of edge indices in the order of `referenced_by`
+//
+// Strings are referenced by their index within STRINGS. The reader interns
+// every string of the table into the symbol table of the net, hence the net
+// does not refer to the file once it is read.
+namespace binary {
+
+  constexpr char MAGIC[8] = {'M', 'R', 'P', 'H', 'N', 'E', 'T', '\0'};
+  constexpr uint32_t VERSION = 1;
+
+  enum struct Section : uint32_t {
+    META = 1,
+    STRINGS,
+    NODES,
+    EDGES,
+    INCOMING,
+  };
+
+} // end of binary namespace
+
+void write_binary(raw_ostream &os, const FrozenNet &net);
+
+inline void write_binary(raw_ostream &os, const AddressableCN &acn) {
+  write_binary(os, FrozenNet(acn));
+}
+
+// NOTE: the buffer is needed only while reading, the net keeps copies of the strings
+Expected<FrozenNet> read_binary(MemoryBufferRef buffer);
+
+// maps the file into memory and reads the net
+Expected<FrozenNet> read_binary_file(StringRef path);
+
+} // end of communication net (cn) namespace
+
+#endif // MRPH_BINARY_NET_H
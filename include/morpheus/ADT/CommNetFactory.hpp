@@ -7,6 +7,7 @@
 
 #include "morpheus/Utils.hpp"
 #include "morpheus/ADT/CommunicationNet.hpp"
+#include "morpheus/ADT/SubnetTable.hpp"
 
 #include <functional>
 
@@ -21,9 +22,9 @@ struct EmptyCN final : public PluginCNBase {
 
   ~EmptyCN() = default;
 
-  EmptyCN(const CallSite &cs) : call_name(cs.getCalledFunction()->getName()) {
-    entry_place().name += call_name;
-    exit_place().name += call_name;
+  EmptyCN(const CallSite &cs)
+    : PluginCNBase(cs.getCalledFunction()->getName().str()),
+      call_name(cs.getCalledFunction()->getName()) {
     add_cf_edge(entry_place(), exit_place());
   }
   EmptyCN(const EmptyCN &) = delete;
@@ -61,7 +62,7 @@ struct CN_MPI_Isend : public PluginCNBase {
   virtual ~CN_MPI_Isend() = default;
 
   CN_MPI_Isend(const CallSite &cs)
-    : name_prefix("send" + get_id()),
+    : name_prefix("send" + std::to_string(get_id())),
       send_params(add_place("<empty>", "", name_prefix + "_params")),
       send_reqst(add_place("(MPI_Request, MessageRequest)", "", name_prefix + "_reqst")),
       send_exit(add_place("Unit", "", name_prefix + "_exit")),
@@ -72,9 +73,9 @@ struct CN_MPI_Isend : public PluginCNBase {
     dest = cs.getArgument(3);
     tag = cs.getArgument(4);
 
-    send_params.type = "(" +
+    send_params.type = intern("(" +
       compute_data_buffer_type(*datatype) + "," +
-      compute_envelope_type(nullptr, dest, *tag) + ")";
+      compute_envelope_type(nullptr, dest, *tag) + ")");
 
     add_input_edge(send_params, send,
                    "(" + compute_data_buffer_value(*datatype, *size) + ","
@@ -130,7 +131,7 @@ struct CN_MPI_RecvBase : public PluginCNBase { // common base class for both blo
   virtual ~CN_MPI_RecvBase() = default;
 
   CN_MPI_RecvBase(const CallSite &cs):
-    name_prefix("recv" + get_id()),
+    name_prefix("recv" + std::to_string(get_id())),
     recv_params(add_place("<empty>", "", name_prefix + "_params")),
     recv_data(add_place("<empty>", "", name_prefix + "_data")),
     recv_reqst(add_place("(MPI_Request, MessageRequest)", "", name_prefix + "_reqst")),
@@ -142,9 +143,9 @@ struct CN_MPI_RecvBase : public PluginCNBase { // common base class for both blo
     source = cs.getArgument(3);
     tag = cs.getArgument(4);
 
-    recv_params.type = compute_envelope_type(source, nullptr, *tag, ",", "(", ")");
+    recv_params.type = intern(compute_envelope_type(source, nullptr, *tag, ",", "(", ")"));
 
-    recv_data.type = compute_data_buffer_type(*datatype);
+    recv_data.type = intern(compute_data_buffer_type(*datatype));
 
     add_input_edge(recv_params, recv,
                    compute_envelope_value(source, nullptr, *tag, false, ",", "(", ")"));
@@ -186,7 +187,8 @@ struct CN_MPI_Irecv : public CN_MPI_RecvBase {
 
       add_unresolved_place(
         recv_data, *mpi_rqst,
-        create_collective_resolve_fn_(recv_data, "msg_tokens|{data=data} =>* data"));
+        create_collective_resolve_fn_(recv_data, "msg_tokens|{data=data} =>* data"),
+        true);
     } else {
       add_unresolved_place(
         recv_reqst, *mpi_rqst,
@@ -265,7 +267,7 @@ struct CN_MPI_Wait final : public PluginCNBase {
   // NOTE: An empty constructor serves to create wait without a "real" request
   // it is resolved by knowledge of particular (blocking) call.
   CN_MPI_Wait()
-    : name_prefix("wait" + get_id()),
+    : name_prefix("wait" + std::to_string(get_id())),
       wait(add_transition({}, name_prefix)),
       unresolved_transition(nullptr) {
 
@@ -389,7 +391,7 @@ struct CN_MPI_Waitall final : public PluginCNBase {
   // TODO: place with statuses
 
   CN_MPI_Waitall(const CallSite &cs)
-    : name_prefix("waitall" + get_id()),
+    : name_prefix("waitall" + std::to_string(get_id())),
       waitall_count(add_place("Int", "", name_prefix + "_count")),
       waitall_rqsts(add_place("(MPI_Request, MessageRequest)", "", name_prefix + "_reqsts")),
       waitall(add_transition({}, name_prefix)) {
@@ -425,25 +427,34 @@ private:
 // ===========================================================================
 // CNs factory
 
-PluginCNGeneric createCommSubnet(const CallSite &cs) {
+// NOTE: the nets are shared by `subnets` if it is given (see SubnetTable.hpp),
+//       the nets with unresolved elements (Irecv, Wait, Waitall) never are
+PluginCNGeneric createCommSubnet(const CallSite &cs, SubnetTable *subnets=nullptr) {
   Function *f = cs.getCalledFunction();
   assert (f->hasName() && "The CNFactory expects call site with a named function");
 
+  auto share = [subnets](auto &&pcn) -> PluginCNGeneric {
+    if (subnets) {
+      return subnets->share(std::move(pcn));
+    }
+    return std::move(pcn);
+  };
+
   StringRef call_name = f->getName();
   if (call_name == "MPI_Isend") {
-    return CN_MPI_Isend(cs);
+    return share(CN_MPI_Isend(cs));
   } else if (call_name == "MPI_Send") {
-    return CN_MPI_Send(cs);
+    return share(CN_MPI_Send(cs));
   } else if (call_name == "MPI_Irecv") {
     return CN_MPI_Irecv(cs);
   } else if (call_name == "MPI_Recv") {
-    return CN_MPI_Recv(cs);
+    return share(CN_MPI_Recv(cs));
   } else if (call_name == "MPI_Wait") {
     return CN_MPI_Wait(cs);
   } else if (call_name == "MPI_Waitall") {
     return CN_MPI_Waitall(cs);
   }
-  return EmptyCN(cs);
+  return share(EmptyCN(cs));
 }
 
 } // end of anonymous namespace
@@ -9,16 +9,28 @@
 #define MRPH_COMM_NET_H
 
 #include "llvm/ADT/BreadthFirstIterator.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/iterator_range.h"
 #include "llvm/Analysis/LoopInfo.h"
 #include "llvm/IR/CallSite.h"
 #include "llvm/IR/CFG.h"
+#include "llvm/Support/Casting.h"
 #include "llvm/Support/raw_ostream.h"
 
 #include "morpheus/Utils.hpp"
+#include "morpheus/ADT/NetArena.hpp"
+#include "morpheus/ADT/Reduction.hpp"
+#include "morpheus/ADT/SlotMap.hpp"
+#include "morpheus/ADT/SymbolTable.hpp"
 #include "morpheus/Formats/Formatter.hpp"
 
 #include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
 #include <map>
 #include <memory>
 #include <set>
@@ -59,7 +71,39 @@ struct Printable {
 
 
 struct Identifiable {
-  using ID = string;
+  using ID = uint32_t;
+
+  // IDAllocator hands out the IDs of identifiable objects. By default, all
+  // threads share the process-wide allocator. A thread building its own nets
+  // can install a private allocator by `IDAllocator::Scope` so that the IDs
+  // (and so the outputs) do not depend on the interleaving of threads.
+  class IDAllocator {
+
+  public:
+    explicit IDAllocator(ID last_id=0) : last_id_(last_id) { }
+    IDAllocator(const IDAllocator &) = delete;
+    IDAllocator& operator=(const IDAllocator &) = delete;
+
+    ID next() {
+      return last_id_.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    // installs the allocator for the current thread until the end of scope
+    struct Scope final {
+      explicit Scope(IDAllocator &allocator);
+      ~Scope();
+      Scope(const Scope &) = delete;
+      Scope& operator=(const Scope &) = delete;
+
+    private:
+      IDAllocator *previous_;
+    };
+
+    static IDAllocator &current();
+
+  private:
+    std::atomic<ID> last_id_;
+  };
 
   virtual ~Identifiable() = default;
 
@@ -73,6 +117,10 @@ struct Identifiable {
     return id;
   }
 
+protected:
+  // NOTE: restores an object of a snapshot under its original ID
+  explicit Identifiable(ID id) : id(id) { }
+
 private:
   static ID generate_id();
 
@@ -81,30 +129,94 @@ private:
 
 
 struct Edge;
+class CommunicationNet;
+class FrozenNet;
+struct SharedSubnetCN;
+struct ThawedElements;
+
+// Elements of nets are allocated within NetArena
+template <typename T>
+using Element = ArenaPtr<T>;
+
+template <typename T>
+using Elements = vector<Element<T>>;
+
+// AdjacencyList keeps the outgoing edges of an element grouped by their
+// category, hence the passes over a single category (e.g. printing of
+// control flow) skip the other edges. Iterating the list itself visits
+// all the edges, the regular ones first.
+class AdjacencyList {
+
+  using iterator_t = Elements<Edge>::iterator;
+  using const_iterator_t = Elements<Edge>::const_iterator;
+
+public:
+  using iterator = concat_iterator<Element<Edge>, iterator_t, iterator_t>;
+  using const_iterator = concat_iterator<const Element<Edge>,
+                                         const_iterator_t, const_iterator_t>;
+
+  Elements<Edge> &of(EdgeCategory category) { return edges_[category]; }
+  const Elements<Edge> &of(EdgeCategory category) const { return edges_[category]; }
+
+  size_t size() const { return edges_[REGULAR].size() + edges_[CONTROL_FLOW].size(); }
+  bool empty() const { return size() == 0; }
+
+  iterator begin() {
+    return iterator(edges_[REGULAR], edges_[CONTROL_FLOW]);
+  }
+  iterator end() {
+    return iterator(make_range(edges_[REGULAR].end(), edges_[REGULAR].end()),
+                    make_range(edges_[CONTROL_FLOW].end(), edges_[CONTROL_FLOW].end()));
+  }
+  const_iterator begin() const {
+    return const_iterator(edges_[REGULAR], edges_[CONTROL_FLOW]);
+  }
+  const_iterator end() const {
+    return const_iterator(make_range(edges_[REGULAR].end(), edges_[REGULAR].end()),
+                          make_range(edges_[CONTROL_FLOW].end(), edges_[CONTROL_FLOW].end()));
+  }
+
+private:
+  Elements<Edge> edges_[2]; // indexed by EdgeCategory
+};
 
 struct NetElement : public Identifiable, public Printable<NetElement> {
 
+  // NOTE: the kind enables LLVM-style casting (isa, cast, dyn_cast),
+  //       as the project is built without RTTI
+  enum struct Kind {
+    PLACE,
+    TRANSITION,
+  };
+
   virtual ~NetElement() = default;
 
-  NetElement(string name) : name(name) { }
+  NetElement(Kind kind, Symbol name) : name(name), kind_(kind) { }
+  NetElement(Kind kind, ID id, Symbol name) : Identifiable(id), name(name), kind_(kind) { }
   NetElement(const NetElement &) = delete;
   NetElement(NetElement &&) = default;
   NetElement& operator=(const NetElement &) = delete;
   NetElement& operator=(NetElement &&) = default;
 
-  virtual string get_element_type() const = 0;
+  inline Kind get_kind() const { return kind_; }
 
-  string name;
-  vector<unique_ptr<Edge>> leads_to;
+  Symbol name;
+  AdjacencyList leads_to;
 
   // NOTE: non-owning pointers to edges that points to the element
   vector<Edge*> referenced_by;
+
+  // position of the element within the storage of its net
+  SlotHandle handle;
+
+private:
+  Kind kind_;
 };
 
 
 struct Edge final : public Printable<Edge> {
 
-  explicit Edge(NetElement &startpoint, NetElement &endpoint, string arc_expr,
+  explicit Edge(NetElement &startpoint, NetElement &endpoint, Symbol arc_expr,
                 EdgeCategory category, EdgeType type)
     : startpoint(startpoint), endpoint(endpoint), arc_expr(arc_expr),
       category(category), type(type) { }
@@ -118,56 +230,66 @@ struct Edge final : public Printable<Edge> {
 
   NetElement &startpoint;
   NetElement &endpoint;
-  string arc_expr;
+  Symbol arc_expr;
 
 private:
   EdgeCategory category;
   EdgeType type;
+
+  // positions of the edge within `startpoint.leads_to.of(category)` and `endpoint.referenced_by`,
+  // they are maintained by CommunicationNet to unlink the edge in constant time
+  size_t out_pos_ = 0;
+  size_t in_pos_ = 0;
+
+  friend CommunicationNet;
 };
 
 
 struct Place final : NetElement {
 
-  explicit Place(string name, string type, string init_expr)
-    : NetElement(name), type(type), init_expr(init_expr) { }
+  explicit Place(Symbol name, Symbol type, Symbol init_expr)
+    : NetElement(Kind::PLACE, name), type(type), init_expr(init_expr) { }
+  explicit Place(ID id, Symbol name, Symbol type, Symbol init_expr)
+    : NetElement(Kind::PLACE, id, name), type(type), init_expr(init_expr) { }
   Place(const Place &) = delete;
   Place(Place &&) = default;
   Place& operator=(const Place &) = delete;
   Place& operator=(Place &&) = default;
 
-  string get_element_type() const {
-    return "place_t";
+  static bool classof(const NetElement *elem) {
+    return elem->get_kind() == Kind::PLACE;
   }
 
-  string type;
-  string init_expr;
+  Symbol type;
+  Symbol init_expr;
 };
 
 
 using ConditionList = vector<string>;
+using Guard = vector<Symbol>;
 
 struct Transition final : NetElement {
 
-  explicit Transition(string name, const ConditionList guard)
-    : NetElement(name), guard(guard) { }
+  explicit Transition(Symbol name, Guard guard)
+    : NetElement(Kind::TRANSITION, name), guard(guard) { }
+  explicit Transition(ID id, Symbol name, Guard guard)
+    : NetElement(Kind::TRANSITION, id, name), guard(guard) { }
   Transition(const Transition &) = delete;
   Transition(Transition &&) = default;
   Transition& operator=(const Transition &) = delete;
   Transition& operator=(Transition &&) = default;
 
-  string get_element_type() const {
-    return "transition_t";
+  static bool classof(const NetElement *elem) {
+    return elem->get_kind() == Kind::TRANSITION;
   }
 
-  ConditionList guard;
+  Guard guard;
 };
 
 
 // -----------------------------------------------------------------------------
 // Unresolved elements
 
-class CommunicationNet;
-
 struct IncompleteEdge final {
   NetElement *startpoint;
   NetElement *endpoint;
@@ -178,7 +300,7 @@ struct IncompleteEdge final {
 
 struct UnresolvedConnect final {
 
-  AddressableCN *acn;
+  AddressableCN *acn = nullptr;
   IncompleteEdge incomplete_edge;
 
   UnresolvedConnect() { }
@@ -189,10 +311,12 @@ struct UnresolvedPlace final {
 
   using ResolveFnTy = function<void(CommunicationNet &cn, Place &, Transition &, UnresolvedConnect &)>;
 
-  UnresolvedPlace(Place &place, const Value &mpi_rqst, ResolveFnTy resolve)
+  UnresolvedPlace(Place &place, const Value &mpi_rqst, ResolveFnTy resolve,
+                  bool collective=false)
     : place(place),
       mpi_rqst(mpi_rqst),
-      resolve(resolve) { }
+      resolve(resolve),
+      collective(collective) { }
   UnresolvedPlace(const UnresolvedPlace &) = delete;
   UnresolvedPlace(UnresolvedPlace &&) = default;
   UnresolvedPlace& operator=(const UnresolvedPlace &) = delete;
@@ -201,6 +325,12 @@ struct UnresolvedPlace final {
   Place &place;
   const Value &mpi_rqst;
   ResolveFnTy resolve;
+  // NOTE: a collective place stands for a whole array of requests,
+  //       hence it is resolved with all the waits of the array.
+  bool collective;
+
+  // position within the storage of its net
+  SlotHandle handle;
 };
 
 struct UnresolvedTransition final {
@@ -216,6 +346,9 @@ struct UnresolvedTransition final {
   Transition &transition;
   const Value &mpi_rqst;
   UnresolvedConnect unresolved_connect;
+
+  // position within the storage of its net
+  SlotHandle handle;
 };
 
 
@@ -227,15 +360,9 @@ struct AddressableCN;
 class CommunicationNet : public Identifiable,
                          public Printable<CommunicationNet> {
 
-  template <typename T>
-  using Element = unique_ptr<T>;
-
-  template <typename T>
-  using Elements = vector<Element<T>>;
-
   template <typename T, typename... Args>
   Element<T> make_element_(Args&&... args) {
-    return std::make_unique<T>(forward<Args>(args)...);
+    return Element<T>(arena_->create<T>(forward<Args>(args)...));
   }
 
 public:
@@ -252,6 +379,56 @@ public:
   };
 
 protected:
+  // -------------------------------------------------------
+  // references to elements
+
+  // ElementRef refers an element of the net, it becomes stale when the
+  // element is removed.
+  struct ElementRef {
+    bool is_place;
+    SlotHandle handle;
+  };
+
+  NetElement *lookup(const ElementRef &ref) const {
+    if (ref.is_place) {
+      return places_.lookup(ref.handle);
+    }
+    return transitions_.lookup(ref.handle);
+  }
+
+  ElementRef ref_of(const NetElement &elem) const {
+    return {isa<Place>(elem), elem.handle};
+  }
+
+  // Makes an emptied net refer to the given arena instead of its own. The
+  // own arena is then kept alive only by the nets that took over its
+  // elements, so it is released together with them.
+  void rebind_arena_(const NetArenaRef &arena) {
+    assert(places_.empty() && transitions_.empty() && "Only an empty net can be rebound.");
+    arena_ = arena;
+  }
+
+  // checks whether the element is stored within this net
+  bool owns(const NetElement &elem) const {
+    if (const Place *p = dyn_cast<Place>(&elem)) {
+      return places_.holds(*p, elem.handle);
+    }
+    return transitions_.holds(cast<Transition>(elem), elem.handle);
+  }
+
+  // all the elements in the order of storage (places first)
+  template <typename Container>
+  Container element_refs() const {
+    Container refs;
+    for (const Element<Place> &p : places_) {
+      refs.insert(refs.end(), {true, p->handle});
+    }
+    for (const Element<Transition> &t : transitions_) {
+      refs.insert(refs.end(), {false, t->handle});
+    }
+    return refs;
+  }
+
   // -------------------------------------------------------
   // removing methods
   using path_t = vector<const Edge *>;
@@ -268,45 +445,14 @@ protected:
   bool remove(NetElement &elem);
 
   void remove_refs(const NetElement &elem) {
-    for (const std::unique_ptr<Edge> &edge : elem.leads_to) {
-      NetElement &pointed_elem = edge->endpoint;
-      auto new_end = std::remove(pointed_elem.referenced_by.begin(),
-                                 pointed_elem.referenced_by.end(),
-                                 edge.get());
-
-      auto old_end = pointed_elem.referenced_by.end();
-      if (new_end != old_end) { // remove erase unspecified elements
-        pointed_elem.referenced_by.erase(new_end, old_end);
-      }
+    for (const Element<Edge> &edge : elem.leads_to) {
+      unlink_in_(*edge);
     }
   }
 
   void remove_edge(const Edge &edge) {
-    NetElement &startpoint = edge.startpoint;
-    NetElement &endpoint = edge.endpoint;
-
-    { // remove the edge
-
-      // As the edge has to be moved to be able to be passed into this function,
-      // there is "invalid" pointer to it which has to be removed.
-      auto it = std::find_if(startpoint.leads_to.begin(),
-                             startpoint.leads_to.end(),
-                             [&edge] (Element<Edge> &e) { return e.get() == &edge; });
-
-      assert (it != startpoint.leads_to.end()
-              && "Existing edge leaves invalid storage place in its starting point.");
-      startpoint.leads_to.erase(it);
-    }
-
-    { // remove stored pointer to referenced edge
-      auto it = std::find_if(endpoint.referenced_by.begin(),
-                             endpoint.referenced_by.end(),
-                             [&edge] (const Edge *e) { return e == &edge; });
-
-      assert (it != endpoint.referenced_by.end()
-              && "Existing edge is supposed to be referenced by endpoint.");
-      endpoint.referenced_by.erase(it);
-    }
+    unlink_in_(edge);
+    unlink_out_(edge); // the returned edge is released immediately
   }
 
   void remove_path(path_t &path) {
@@ -346,61 +492,61 @@ protected:
   using color_t = unsigned short;
   using coloured_elem_t = pair<const NetElement *, color_t>;
   using elem_colors_t = map<const NetElement *, set<color_t>>;
+  // NOTE: The backward walk of each color is a single chain of edges, hence
+  //       a partial backward path of a coloured element is a prefix of the
+  //       walk and only the length of the prefix is stored.
+  using pbw_lengths_t = map<coloured_elem_t, size_t>;
 
   vector<path_t> backtrack_edge(const Edge &edge,
                                 color_t color,
                                 elem_colors_t &assigned_colors,
-                                std::map<coloured_elem_t, path_t> &pbw_paths) const {
+                                pbw_lengths_t &pbw_lengths,
+                                vector<path_t> &bw_walks) const {
 
-    const NetElement *startpoint = &edge.startpoint;
-    const NetElement *endpoint = &edge.endpoint;
-    auto pbw_path_it = pbw_paths.find({endpoint, color});
+    path_t &bw_walk = bw_walks[color - 1];
 
-    assert(pbw_path_it != pbw_paths.end()
-           && "The endpoint of the given edge has to already be among paths");
-    const path_t &pbw_path = pbw_path_it->second;
+    for (const Edge *e = &edge; e; ) {
+      const NetElement *startpoint = &e->startpoint;
 
-    // prolong the partial path and store it to the starting point
-    path_t e_pbw_path(pbw_path); // make a copy
-    e_pbw_path.push_back(&edge); // prolong the path
-    pbw_paths.insert({ {startpoint, color}, move(e_pbw_path) });
+      // prolong the walk and store the partial path to the starting point
+      bw_walk.push_back(e);
+      pbw_lengths.insert({ {startpoint, color}, bw_walk.size() });
 
-    // vector<const Edge *> unprocessed;
-    const Edge *unprocessed_edge = nullptr;
+      const Edge *unprocessed_edge = nullptr;
 
-    auto colors_it = assigned_colors.find(startpoint);
-    if (colors_it == assigned_colors.end()) {
-    // the element is colored for the first time
+      auto colors_it = assigned_colors.find(startpoint);
+      if (colors_it == assigned_colors.end()) {
+      // the element is colored for the first time
 
-      // color the starting point
-      assigned_colors.insert({startpoint, {color}});
+        // color the starting point
+        assigned_colors.insert({startpoint, {color}});
 
-      if (startpoint->referenced_by.size() == 1) {
-        // process only further edges if there is no branching
-        unprocessed_edge = startpoint->referenced_by.back();
-      }
-    } else {
-    // the element was already colored by a color
+        if (startpoint->referenced_by.size() == 1) {
+          // process only further edges if there is no branching
+          unprocessed_edge = startpoint->referenced_by.back();
+        }
+      } else {
+      // the element was already colored by a color
 
-      set<color_t> &used_colors = colors_it->second;
-      used_colors.insert(color);
+        set<color_t> &used_colors = colors_it->second;
+        used_colors.insert(color);
 
-      if (used_colors.size() > 1) { // the inserted color might be the same one
+        if (used_colors.size() > 1) { // the inserted color might be the same one
 
-        // two different colors means two independent parallel paths
-        vector<path_t> prl_bw_paths; // parallel backward paths
-        for (auto const& c : used_colors) {
-          auto it = pbw_paths.find({startpoint, c});
-          assert (it != pbw_paths.end());
+          // two different colors means two independent parallel paths
+          vector<path_t> prl_bw_paths; // parallel backward paths
+          for (auto const& c : used_colors) {
+            auto it = pbw_lengths.find({startpoint, c});
+            assert (it != pbw_lengths.end());
 
-          prl_bw_paths.push_back(it->second);
+            const path_t &walk = bw_walks[c - 1];
+            prl_bw_paths.emplace_back(walk.begin(), walk.begin() + it->second);
+          }
+          return prl_bw_paths;
         }
-        return prl_bw_paths;
       }
-    }
 
-    if (unprocessed_edge) {
-      return backtrack_edge(*unprocessed_edge, color, assigned_colors, pbw_paths);
+      e = unprocessed_edge;
     }
 
     return {};
@@ -415,16 +561,18 @@ protected:
 
     color_t color = 0;
     elem_colors_t assigned_colors;
-    map<coloured_elem_t, path_t> pbw_paths; // partial backward paths
+    pbw_lengths_t pbw_lengths; // lengths of partial backward paths
+    vector<path_t> bw_walks(elem.referenced_by.size()); // backward walk of each color
 
     for (const Edge *edge : elem.referenced_by) {
       color_t c = ++color;
       const NetElement *endpoint = &edge->endpoint;
 
       assigned_colors.insert({ endpoint, {c} });
-      pbw_paths.insert({ {endpoint, c}, {} });
+      pbw_lengths.insert({ {endpoint, c}, 0 });
 
-      vector<path_t> found_bw_paths = backtrack_edge(*edge, c, assigned_colors, pbw_paths);
+      vector<path_t> found_bw_paths = backtrack_edge(*edge, c, assigned_colors,
+                                                     pbw_lengths, bw_walks);
       move(found_bw_paths.begin(),
            found_bw_paths.end(),
            back_inserter(resulting_paths));
@@ -432,41 +580,81 @@ protected:
     return resulting_paths;
   }
 
-  vector<path_t> find_parallel_paths(const vector<const NetElement *> &elements) {
+  // PendingElements keeps the elements pending for the reduction of parallel
+  // paths, they are ordered by their position in the storage.
+  struct PendingElements {
+    vector<ElementRef> refs;
+    DenseMap<const NetElement *, size_t> positions;
+    set<size_t> queue;
 
-    for (const NetElement *elem : elements) {
-      if (elem->referenced_by.size() > 1) {
-        vector<path_t> found_paths = backtrack_parallel_paths(*elem);
-        if (!found_paths.empty()) {
-          for (path_t &path : found_paths) {
-            // reverse each path to change the backward storage
-            reverse(path.begin(), path.end());
-          }
-          return found_paths;
-        }
+    // NOTE: the elements of other nets are not reduced
+    void push(const NetElement &elem) {
+      auto it = positions.find(&elem);
+      if (it != positions.end()) {
+        queue.insert(it->second);
       }
     }
+  };
 
-    return {};
+  // Adds the elements whose backtracking reads any of the changed elements
+  // among the pending ones, i.e. the elements reachable from the changed
+  // ones through elements with a single incoming edge.
+  void add_dependent(PendingElements &pending,
+                     const vector<const NetElement *> &changed) const {
+    set<const NetElement *> visited;
+    vector<const NetElement *> stack(changed);
+
+    while (!stack.empty()) {
+      const NetElement *elem = stack.back();
+      stack.pop_back();
+
+      if (!visited.insert(elem).second) {
+        continue;
+      }
+      pending.push(*elem);
+
+      for (const Element<Edge> &e : elem->leads_to) {
+        const NetElement &endpoint = e->endpoint;
+        if (endpoint.referenced_by.size() == 1) {
+          stack.push_back(&endpoint); // backtracking passes through the endpoint
+        } else {
+          pending.push(endpoint);
+        }
+      }
+    }
   }
 
-  void reduce_parallel_paths() {
+  // returns the number of removed paths
+  size_t reduce_parallel_paths() {
     EdgePredicate<CONTROL_FLOW> is_cf;
 
-    // put both places and transitions into one (NetElement*) vector
-    vector<const NetElement*> elements;
-    transform(places_.begin(), places_.end(), back_inserter(elements),
-              [] (const Element<Place> &place) { return place.get(); });
-    transform(transitions_.begin(), transitions_.end(), back_inserter(elements),
-              [] (const Element<Transition> &transition) { return transition.get(); });
+    // NOTE: The elements are checked in the order of storage. A removed path
+    //       changes only the elements around it, hence only the elements
+    //       depending on them are checked again. The first pending element
+    //       is always the first one with parallel paths, since all the
+    //       preceding ones are known to have none.
+    PendingElements pending;
+    pending.refs = element_refs<vector<ElementRef>>();
+    for (size_t pos = 0; pos < pending.refs.size(); pos++) {
+      pending.positions[lookup(pending.refs[pos])] = pos;
+      pending.queue.insert(pending.queue.end(), pos);
+    }
 
-    // find and remove paths
+    size_t removed = 0;
+    while (!pending.queue.empty()) {
+      const NetElement *elem = lookup(pending.refs[*pending.queue.begin()]);
+      pending.queue.erase(pending.queue.begin());
+
+      if (!elem || elem->referenced_by.size() < 2) {
+        continue;
+      }
+
+      vector<path_t> found_paths = backtrack_parallel_paths(*elem);
+      if (found_paths.empty()) {
+        continue;
+      }
 
-    // NOTE: maybe it would help to topologically sort the nodes,
-    //       but it is rather minor performance improvement.
-    while (true) {
       path_t to_remove;
-      vector<path_t> found_paths = find_parallel_paths(elements);
       for (path_t &p : found_paths) {
         if (all_of(p.begin(), p.end(), is_cf)) {
           swap(p, to_remove);
@@ -475,24 +663,49 @@ protected:
       }
 
       if (to_remove.empty()) {
-        // if no parallel edge is found break the cycle,
-        // otherwise run the procedure on reduced graph
+        // none of the first found paths can be removed, stop the reduction
         break;
+      }
 
-      } else {
-        remove_path(to_remove);
+      // reverse the path to change the backward storage
+      reverse(to_remove.begin(), to_remove.end());
+
+      // elements whose incoming edges are changed by the removal
+      vector<const NetElement *> changed{elem};
+      set<const NetElement *> inner; // inner elements of the path
+      for (size_t i = 0; i + 1 < to_remove.size(); i++) {
+        inner.insert(&to_remove[i]->endpoint);
       }
+      for (const NetElement *ne : inner) {
+        if (!owns(*ne)) {
+          changed.push_back(ne); // only the edges of the element are removed
+          continue;
+        }
+        for (const Element<Edge> &e : ne->leads_to) {
+          if (!inner.count(&e->endpoint)) {
+            changed.push_back(&e->endpoint);
+          }
+        }
+      }
+
+      remove_path(to_remove);
+      add_dependent(pending, changed);
+      removed++;
     }
+    return removed;
   }
 
   bool is_collapsible(const Edge &e) const {
     EdgePredicate<CONTROL_FLOW> is_cf;
 
-    if (e.startpoint.get_element_type() == e.endpoint.get_element_type() && is_cf(e)) {
-      if (e.startpoint.get_element_type() == "place_t") {
-        Place &p1 = static_cast<Place&>(e.startpoint);
-        Place &p2 = static_cast<Place&>(e.endpoint);
-        if (p1.type == p2.type) {
+    if (&e.startpoint == &e.endpoint) { // self-loop cannot be collapsed
+      return false;
+    }
+
+    if (e.startpoint.get_kind() == e.endpoint.get_kind() && is_cf(e)) {
+      if (const Place *p1 = dyn_cast<Place>(&e.startpoint)) {
+        const Place &p2 = cast<Place>(e.endpoint);
+        if (p1->type == p2.type) {
           return true;
         }
       } else {
@@ -508,21 +721,21 @@ protected:
                              //       info at the startpoint as the startpoint is
                              //       not going to be preserved.
 
-    for (Edge *ref_e : startpoint.referenced_by) {
-      Elements<Edge> &owner_storage = ref_e->startpoint.leads_to;
-
-      // find a unique pointer owning the reference pointer `ref_e`
-      auto owner_it = std::find_if(owner_storage.begin(),
-                             owner_storage.end(),
-                             [ref_e](const Element<Edge> &o) { return o.get() == ref_e; });
-
-      assert (owner_it != owner_storage.end() && "The owner has to exist!");
+    redirect_incoming(startpoint, e.endpoint);
+  }
 
-      Element<Edge> &edge = *owner_it;
+  // Redirects the edges incoming to `from` to `to`. The edges are replaced
+  // in place, hence `from` keeps dangling references and has to be released.
+  void redirect_incoming(NetElement &from, NetElement &to) {
+    for (Edge *ref_e : from.referenced_by) {
+      // the unique pointer owning the reference pointer `ref_e`
+      Element<Edge> &edge = ref_e->startpoint.leads_to.of(ref_e->get_category())[ref_e->out_pos_];
+      assert (edge.get() == ref_e && "The owner has to exist!");
 
       // create a new bypassing edge
-      Element<Edge> new_edge = create_edge_(edge->startpoint, e.endpoint, edge->arc_expr,
+      Element<Edge> new_edge = create_edge_(edge->startpoint, to, edge->arc_expr,
                                             edge->get_category(), edge->get_type());
+      new_edge->out_pos_ = ref_e->out_pos_;
 
       // swap the new edge with the old one
       std::swap(edge, new_edge);
@@ -531,6 +744,9 @@ protected:
 
   void reconnect_to_startpoint(Edge &e) { // The startpoint of the edge remains preserved
     NetElement &endpoint = e.endpoint;
+    remove_refs(endpoint); // NOTE: The endpoint is not going to be preserved, hence
+                           //       its edges cannot be referenced any more.
+
     for (Element<Edge> &edge : endpoint.leads_to) {
       Element<Edge> new_edge = create_edge_(e.startpoint, edge->endpoint, edge->arc_expr,
                                             edge->get_category(), edge->get_type());
@@ -542,50 +758,106 @@ protected:
     remove_edge(e);
   }
 
-  template <typename T>
-  void collapse_topdown(Elements<T> &elements,
-                 CommunicationNet &tmp_cn,
-                 Elements<T> CommunicationNet::*storage) {
-
-    size_t idx = 0;
-    while (idx < elements.size()) {
-      Element<T> &elem = elements[idx];
-      if (elem->leads_to.size() == 1) { // only one-path nodes can be collapsed
-        Element<Edge> &e = elem->leads_to.back();
-        if (is_collapsible(*e)) {
-          reconnect_to_endpoint(*e);
-
-          // skip the element, hence remove it
-          idx++;
-          continue;
+  // -------------------------------------------------------
+  // worklist of the collapse
+
+  using worklist_t = deque<ElementRef>;
+
+  void enqueue(worklist_t &worklist, const NetElement &elem) const {
+    // NOTE: the neighbour may belong to a different net (e.g. to the interface
+    //       of AddressableCN), such elements are not collapsed.
+    if (owns(elem)) {
+      worklist.push_back(ref_of(elem));
+    }
+  }
+
+  // releases the element from the storage, its edges have to be already unlinked
+  void release(NetElement &elem) {
+    if (isa<Place>(elem)) {
+      places_.take(elem.handle);
+    } else {
+      transitions_.take(elem.handle);
+    }
+  }
+
+  // An element with a single outgoing collapsible edge is merged into the
+  // endpoint of the edge. The endpoint gets new incoming edges and so it
+  // has to be checked bottom-up again.
+  void collapse_topdown(worklist_t &worklist, worklist_t &bottomup) {
+    while (!worklist.empty()) {
+      NetElement *elem = lookup(worklist.front());
+      worklist.pop_front();
+
+      if (elem && elem->leads_to.size() == 1) { // only one-path nodes can be collapsed
+        Edge &e = **elem->leads_to.begin();
+        if (is_collapsible(e)) {
+          NetElement &endpoint = e.endpoint;
+          reconnect_to_endpoint(e);
+          release(*elem);
+          enqueue(bottomup, endpoint);
         }
       }
-      // takeover element
-      tmp_cn.add_(move(elem), tmp_cn.*storage);
-      idx++;
     }
   }
 
-  template <typename T>
-  void collapse_bottomup(Elements<T> &elements,
-                         CommunicationNet &tmp_cn,
-                         Elements<T> CommunicationNet::*storage) {
-
-    size_t idx = 0;
-    while (idx < elements.size()) {
-      Element<T> &elem = elements[idx];
-      if (elem->referenced_by.size() == 1) {
-        Edge *e = elem->referenced_by.back();
-        if (is_collapsible(*e)) {
-          reconnect_to_startpoint(*e);
-
-          // skip the element, and so remove it
-          idx++;
-          continue;
+  // An element with a single incoming collapsible edge is merged into the
+  // startpoint of the edge. The startpoint gets new outgoing edges and so it
+  // has to be checked top-down again.
+  void collapse_bottomup(worklist_t &worklist, worklist_t &topdown) {
+    while (!worklist.empty()) {
+      NetElement *elem = lookup(worklist.front());
+      worklist.pop_front();
+
+      if (elem && elem->referenced_by.size() == 1) {
+        Edge &e = *elem->referenced_by.back();
+        if (is_collapsible(e)) {
+          NetElement &startpoint = e.startpoint;
+          reconnect_to_startpoint(e);
+          release(*elem);
+          enqueue(topdown, startpoint);
         }
       }
-      tmp_cn.add_(move(elem), tmp_cn.*storage);
-      idx++;
+    }
+  }
+
+  // fuses the control flow chains, returns the number of released elements
+  size_t collapse_chains();
+
+  // -------------------------------------------------------
+  // further reduction rules (see `reduce`)
+  //
+  // NOTE: The rules return the number of their applications. The elements
+  //       of other nets and the pinned ones (referred by unresolved elements
+  //       or by the owner of the net) are never removed.
+
+  using pinned_t = DenseSet<const NetElement *>;
+
+  size_t fuse_series(const pinned_t &pinned);
+  size_t remove_self_loops(const pinned_t &pinned);
+  size_t remove_identity_transitions(const pinned_t &pinned);
+  size_t remove_dead_places(const pinned_t &pinned);
+  size_t merge_equivalent_places(const pinned_t &pinned);
+
+  ReductionStats reduce_(const ReductionRules &rules, pinned_t pinned);
+
+  bool is_removable(const NetElement &elem, const pinned_t &pinned) const {
+    return owns(elem) && !pinned.count(&elem);
+  }
+
+  // removes the element with all its incoming and outgoing edges
+  void erase(NetElement &elem) {
+    while (!elem.referenced_by.empty()) {
+      remove_edge(*elem.referenced_by.back());
+    }
+    remove_refs(elem);
+    release(elem);
+  }
+
+  // copies the outgoing edges of `from` to `to`, the self-loops of `from` become self-loops of `to`
+  void copy_outgoing(const NetElement &from, NetElement &to) {
+    for (const Element<Edge> &e : from.leads_to) {
+      NetElement &endpoint = &e->endpoint == &from ? to : e->endpoint;
+      add_edge_(create_edge_(to, endpoint, e->arc_expr, e->get_category(), e->get_type()));
     }
   }
 
@@ -596,6 +868,11 @@ public:
   virtual ~CommunicationNet() = default;
 
   CommunicationNet() = default;
+  // NOTE: the net shares the arena, hence the elements can be freely moved
+  //       between both the nets.
+  explicit CommunicationNet(const NetArenaRef &arena) : arena_(arena) { }
+  // NOTE: restores the net of a snapshot under its original ID
+  CommunicationNet(const NetArenaRef &arena, ID id) : Identifiable(id), arena_(arena) { }
   CommunicationNet(const CommunicationNet &) = delete;
   CommunicationNet(CommunicationNet &&) = default;
   CommunicationNet& operator=(const CommunicationNet &) = delete;
@@ -604,6 +881,9 @@ public:
 
   virtual void resolve_unresolved();
   virtual void collapse();
+  // Applies the enabled rules until none of them changes the net. Unlike
+  // `collapse`, the fused chains are checked again after the other rules.
+  virtual ReductionStats reduce(const ReductionRules &rules);
   virtual void takeover(CommunicationNet cn);
 
   virtual void clear() {
@@ -611,8 +891,37 @@ public:
     transitions_.clear();
   }
 
+  bool has_unresolved() const {
+    return unresolved_places_.size() > 0 || unresolved_transitions_.size() > 0;
+  }
+
+  // Removes all the edges incident to the elements of the net. Each edge is
+  // passed to `fn` right before its removal, so a complete part of a larger
+  // net can be written out and released (see DotStream).
+  template <typename EdgeFn>
+  void release_edges(EdgeFn fn) {
+    auto release = [&](NetElement &elem) {
+      while (!elem.referenced_by.empty()) {
+        const Edge &e = *elem.referenced_by.back();
+        fn(e);
+        remove_edge(e);
+      }
+      while (!elem.leads_to.empty()) {
+        const Edge &e = **elem.leads_to.begin();
+        fn(e);
+        remove_edge(e);
+      }
+    };
+    for (const Element<Place> &p : places_) {
+      release(*p);
+    }
+    for (const Element<Transition> &t : transitions_) {
+      release(*t);
+    }
+  }
+
   Place& add_place(string type, string init_expr, string name="") {
-    return add_(make_element_<Place>(name, type, init_expr), places_);
+    return add_(make_element_<Place>(intern(name), intern(type), intern(init_expr)), places_);
   }
 
   Place& add_place(Element<Place> p) {
@@ -620,18 +929,32 @@ public:
   }
 
   Transition& add_transition(ConditionList cl, string name="") {
-    return add_(make_element_<Transition>(name, cl), transitions_);
+    Guard guard;
+    guard.reserve(cl.size());
+    for (const string &cond : cl) {
+      guard.push_back(intern(cond));
+    }
+    return add_(make_element_<Transition>(intern(name), move(guard)), transitions_);
   }
 
   Transition& add_transition(Element<Transition> t) {
     return add_(move(t), transitions_);
   }
 
+  const NetArenaRef &arena() const {
+    return arena_;
+  }
+
+  // interns the string within the symbol table of the net
+  Symbol intern(StringRef str) {
+    return arena_->symbols().intern(str);
+  }
+
   template <typename Startpoint, typename Endpoint>
   inline Edge& add_edge(Startpoint &start, Endpoint &end, string ae,
                          EdgeCategory category, EdgeType type) {
 
-    return add_edge_(create_edge_(start, end, ae, category, type));
+    return add_edge_(create_edge_(start, end, intern(ae), category, type));
   }
 
   Edge& add_input_edge(Place &src, Transition &dest, string ae="",
@@ -650,8 +973,10 @@ public:
 
   UnresolvedPlace& add_unresolved_place(Place &place,
                                         const Value &mpi_rqst,
-                                        UnresolvedPlace::ResolveFnTy resolve) {
-    return add_(make_element_<UnresolvedPlace>(place, mpi_rqst, resolve), unresolved_places_);
+                                        UnresolvedPlace::ResolveFnTy resolve,
+                                        bool collective=false) {
+    return add_(make_element_<UnresolvedPlace>(place, mpi_rqst, resolve, collective),
+                unresolved_places_);
   }
 
   UnresolvedTransition& add_unresolved_transition(Transition &transition,
@@ -662,35 +987,35 @@ public:
   // -------------------------------------------------------
   // iterators
 
-  iterator_range<typename Elements<Place>::iterator> places() {
+  iterator_range<typename SlotMap<Place>::iterator> places() {
     return make_range(places_.begin(), places_.end());
   }
 
-  iterator_range<typename Elements<Place>::const_iterator> places() const {
+  iterator_range<typename SlotMap<Place>::const_iterator> places() const {
     return make_range(places_.begin(), places_.end());
   }
 
-  iterator_range<typename Elements<Transition>::iterator> transitions() {
+  iterator_range<typename SlotMap<Transition>::iterator> transitions() {
     return make_range(transitions_.begin(), transitions_.end());
   }
 
-  iterator_range<typename Elements<Transition>::const_iterator> transitions() const {
+  iterator_range<typename SlotMap<Transition>::const_iterator> transitions() const {
     return make_range(transitions_.begin(), transitions_.end());
   }
 
-  iterator_range<typename Elements<UnresolvedPlace>::iterator> unresolved_places() {
+  iterator_range<typename SlotMap<UnresolvedPlace>::iterator> unresolved_places() {
     return make_range(unresolved_places_.begin(), unresolved_places_.end());
   }
 
-  iterator_range<typename Elements<UnresolvedPlace>::const_iterator> unresolved_places() const {
+  iterator_range<typename SlotMap<UnresolvedPlace>::const_iterator> unresolved_places() const {
     return make_range(unresolved_places_.begin(), unresolved_places_.end());
   }
 
-  iterator_range<typename Elements<UnresolvedTransition>::iterator> unresolved_transitions() {
+  iterator_range<typename SlotMap<UnresolvedTransition>::iterator> unresolved_transitions() {
     return make_range(unresolved_transitions_.begin(), unresolved_transitions_.end());
   }
 
-  iterator_range<typename Elements<UnresolvedTransition>::const_iterator>
+  iterator_range<typename SlotMap<UnresolvedTransition>::const_iterator>
   unresolved_transitions() const {
     return make_range(unresolved_transitions_.begin(), unresolved_transitions_.end());
   }
@@ -703,45 +1028,94 @@ private:
   }
 
   template <typename T>
-  inline bool remove_(T &elem, Elements<T> &elements) {
-    auto it = std::find_if(elements.begin(),
-                           elements.end(),
-                           [&elem] (const Element<T> &e) { return e.get() == &elem; });
-    if (it != elements.end()) {
-      remove_refs(**it);  // remove references to the node
-      elements.erase(it); // remove the element itself
+  inline T& add_(Element<T> &&e, SlotMap<T> &elements) {
+    T &elem = *e;
+    elem.handle = elements.insert(forward<Element<T>>(e));
+    return elem;
+  }
+
+  template <typename T>
+  inline bool remove_(T &elem, SlotMap<T> &elements) {
+    if (elements.holds(elem, elem.handle)) {
+      remove_refs(elem);            // remove references to the node
+      elements.take(elem.handle);   // remove the element itself
       return true;
     }
     return false;
   }
 
+  template <typename T>
+  inline void splice_(SlotMap<T> &target, SlotMap<T> &src) {
+    target.splice(src, [](T &elem, SlotHandle handle) { elem.handle = handle; });
+  }
+
   template <typename Startpoint, typename Endpoint>
-  inline Element<Edge> create_edge_(Startpoint &start, Endpoint &end, string ae,
+  inline Element<Edge> create_edge_(Startpoint &start, Endpoint &end, Symbol ae,
                                     EdgeCategory category, EdgeType type) {
 
     Element<Edge> edge = make_element_<Edge>(start, end, ae, category, type);
     // the end element keeps the pointer to edge which is pointing to it
+    edge->in_pos_ = end.referenced_by.size();
     end.referenced_by.push_back(edge.get());
 
     return edge;
   }
 
   inline Edge& add_edge_(Element<Edge> edge) {
-    return add_(move(edge), edge->startpoint.leads_to);
+    Elements<Edge> &leads_to = edge->startpoint.leads_to.of(edge->get_category());
+    edge->out_pos_ = leads_to.size();
+    return add_(move(edge), leads_to);
   }
 
-  template <typename T>
-  inline void takeover_(Elements<T> &target, iterator_range<typename Elements<T>::iterator> src) {
-    move(src.begin(), src.end(), back_inserter(target));
+  // NOTE: the edges are unlinked by moving the last edge into the freed
+  //       position, hence the order of edges is not preserved.
+  void unlink_in_(const Edge &edge) {
+    vector<Edge *> &referenced_by = edge.endpoint.referenced_by;
+    assert (edge.in_pos_ < referenced_by.size() && referenced_by[edge.in_pos_] == &edge
+            && "Existing edge is supposed to be referenced by endpoint.");
+
+    Edge *last = referenced_by.back();
+    last->in_pos_ = edge.in_pos_;
+    referenced_by[edge.in_pos_] = last;
+    referenced_by.pop_back();
   }
 
-  Elements<Place> places_;
-  Elements<Transition> transitions_;
+  Element<Edge> unlink_out_(const Edge &edge) {
+    Elements<Edge> &leads_to = edge.startpoint.leads_to.of(edge.get_category());
+    assert (edge.out_pos_ < leads_to.size() && leads_to[edge.out_pos_].get() == &edge
+            && "Existing edge leaves invalid storage place in its starting point.");
 
-  Elements<UnresolvedPlace> unresolved_places_;
-  Elements<UnresolvedTransition> unresolved_transitions_;
+    Element<Edge> unlinked = move(leads_to[edge.out_pos_]);
+    if (edge.out_pos_ != leads_to.size() - 1) {
+      leads_to.back()->out_pos_ = edge.out_pos_;
+      leads_to[edge.out_pos_] = move(leads_to.back());
+    }
+    leads_to.pop_back();
+    return unlinked;
+  }
+
+  // NOTE: the arena is declared first to be released after the elements
+  NetArenaRef arena_;
+
+  SlotMap<Place> places_;
+  SlotMap<Transition> transitions_;
+
+  SlotMap<UnresolvedPlace> unresolved_places_;
+  SlotMap<UnresolvedTransition> unresolved_transitions_;
+
+  // Reorders the edges referencing the element, `edges` has to be
+  // a permutation of `elem.referenced_by`.
+  static void reorder_referenced_by_(NetElement &elem, vector<Edge *> edges) {
+    assert (edges.size() == elem.referenced_by.size());
+    for (size_t i = 0; i < edges.size(); i++) {
+      edges[i]->in_pos_ = i;
+    }
+    elem.referenced_by = move(edges);
+  }
 
   friend AddressableCN; // make AddressableCN a friend class to override remove methods
+  friend FrozenNet;     // FrozenNet restores the nets of its snapshots
+  friend SharedSubnetCN; // SharedSubnetCN restores the edges of shared shapes
 };
 
 // =============================================================================
@@ -767,9 +1141,12 @@ struct AddressableCN final : public CommunicationNet {
       arr(add_place("MessageRequest", "", "ActiveReceiveRequest")),
       csr(add_place("MessageRequest", "", "CompletedSendRequest")),
       crr(add_place("MessageToken", "", "CompletedReceiveRequest")),
-      embedded_cn(CommunicationNet()),
-      entry_p_(&add_place("Unit", "", "ACN" + std::to_string(address) + "Entry" + get_id())),
-      exit_p_(&add_place("Unit", "", "ACN" + std::to_string(address) + "Exit" + get_id())) { }
+      embedded_cn(arena()),
+      entry_p_(&add_place("Unit", "", "ACN" + std::to_string(address) + "Entry" + std::to_string(get_id()))),
+      exit_p_(&add_place("Unit", "", "ACN" + std::to_string(address) + "Exit" + std::to_string(get_id()))) { }
+
+  // restores the net of a snapshot, see FrozenNet::thaw
+  explicit AddressableCN(const FrozenNet &net);
 
   AddressableCN(const AddressableCN &) = delete;
   AddressableCN(AddressableCN &&) = default;
@@ -783,6 +1160,11 @@ struct AddressableCN final : public CommunicationNet {
     embedded_cn.collapse();
   }
 
+  ReductionStats reduce(const ReductionRules &rules) override {
+    // NOTE: the entry and exit places are kept if they are part of the embedded net
+    return embedded_cn.reduce_(rules, {entry_p_, exit_p_});
+  }
+
   void takeover (CommunicationNet cn) override {
     embedded_cn.takeover(move(cn));
   }
@@ -798,6 +1180,8 @@ struct AddressableCN final : public CommunicationNet {
 
   Place& entry_place() { return *entry_p_; }
   Place& exit_place() { return *exit_p_; }
+  const Place& entry_place() const { return *entry_p_; }
+  const Place& exit_place() const { return *exit_p_; }
 
   void set_entry(Place &p) { entry_p_ = &p; }
   void set_exit(Place &p) { exit_p_ = &p; }
@@ -808,6 +1192,8 @@ struct AddressableCN final : public CommunicationNet {
   }
 
 private:
+  AddressableCN(const FrozenNet &net, ThawedElements &&elements);
+
   // override the protected methods to work correctly within the context of addressable CN
   bool remove(Place &p) override {
     return remove_(p);
@@ -836,17 +1222,41 @@ private:
 // =============================================================================
 // Generic Plugin CN
 
+// PluginCNGeneric type-erases pluggable nets. A net is stored within the
+// object itself unless it is larger than the inline buffer, so the plugin
+// nets created per MPI call are not allocated on the heap.
 class PluginCNGeneric {
 
+  // NOTE: the buffer fits all the nets of CommNetFactory.hpp
+  static constexpr size_t INLINE_SIZE = 640;
+
 public:
-  ~PluginCNGeneric() = default;
+  ~PluginCNGeneric() {
+    reset_();
+  }
 
   template <typename PluggableCN>
-  PluginCNGeneric(PluggableCN &&net)
-    : self_(std::make_unique<model<PluggableCN>>(forward<PluggableCN>(net))) { }
+  PluginCNGeneric(PluggableCN &&net) {
+    using model_t = model<PluggableCN>;
+    if (sizeof(model_t) <= INLINE_SIZE && alignof(model_t) <= alignof(std::max_align_t)) {
+      self_ = new (buffer_) model_t(forward<PluggableCN>(net));
+      inline_ = true;
+    } else {
+      self_ = new model_t(forward<PluggableCN>(net));
+    }
+  }
 
   PluginCNGeneric(const PluginCNGeneric &) = delete;
-  PluginCNGeneric(PluginCNGeneric &&) = default;
+  PluginCNGeneric(PluginCNGeneric &&pcn) : inline_(pcn.inline_) {
+    if (inline_) {
+      self_ = pcn.self_->move_to_(buffer_);
+      pcn.reset_();
+    } else {
+      std::swap(self_, pcn.self_);
+    }
+  }
+  PluginCNGeneric& operator=(const PluginCNGeneric &) = delete;
+  PluginCNGeneric& operator=(PluginCNGeneric &&) = delete;
 
   // ---------------------------------------------------------------------------
   // accessible methods of PluggableCNs
@@ -855,10 +1265,11 @@ public:
     self_->connect_(acn);
   }
 
+  // NOTE: the net is emptied by the injection, hence it is destroyed
   template <typename PluggableCN>
   void inject_into(PluggableCN &pcn) {
-    move(self_)->inject_into_(pcn);
-    self_.release();
+    self_->inject_into_(pcn);
+    reset_();
   }
 
   void add_cf_edge(NetElement& src, NetElement& dest) {
@@ -869,8 +1280,8 @@ public:
 
   template <typename PluggableCN>
   void renounce_in_favor_of(PluggableCN &pcn) {
-    move(self_)->renounce_in_favor_of_(pcn);
-    self_.release();
+    self_->renounce_in_favor_of_(pcn);
+    reset_();
   }
 
   Place& entry_place() { return self_->entry_place_(); }
@@ -905,6 +1316,8 @@ private:
     virtual void set_exit_(Place &) = 0;
     virtual void enclose_() = 0;
     virtual void print_(ostream &os, const formats::Formatter &fmt) const = 0;
+    // moves the net into the buffer of another PluginCNGeneric
+    virtual pluggable_t *move_to_(void *buffer) = 0;
   };
 
   template <typename PluggableCN>
@@ -963,10 +1376,29 @@ private:
       pcn_.print(os, fmt);
     }
 
+    pluggable_t *move_to_(void *buffer) override {
+      return new (buffer) model(move(pcn_));
+    }
+
     PluggableCN pcn_;
   };
 
-  unique_ptr<pluggable_t> self_;
+  void reset_() {
+    if (!self_) {
+      return;
+    }
+    if (inline_) {
+      self_->~pluggable_t();
+    } else {
+      delete self_;
+    }
+    self_ = nullptr;
+    inline_ = false;
+  }
+
+  pluggable_t *self_ = nullptr;
+  bool inline_ = false;
+  alignas(std::max_align_t) char buffer_[INLINE_SIZE];
 };
 
 
@@ -977,9 +1409,11 @@ class PluginCNBase : public CommunicationNet {
 public:
   virtual ~PluginCNBase() = default;
 
-  PluginCNBase()
-    : entry_p_(&add_place("Unit", "", "entry" + get_id())),
-      exit_p_(&add_place("Unit", "", "exit" + get_id())) { }
+  PluginCNBase() : PluginCNBase("") { }
+  // NOTE: the suffix is appended to the names of entry and exit places
+  explicit PluginCNBase(const string &name_suffix)
+    : entry_p_(&add_place("Unit", "", "entry" + std::to_string(get_id()) + name_suffix)),
+      exit_p_(&add_place("Unit", "", "exit" + std::to_string(get_id()) + name_suffix)) { }
   PluginCNBase(const PluginCNBase &) = delete;
   PluginCNBase(PluginCNBase &&) = default;
 
@@ -1010,6 +1444,19 @@ public:
     add_cf_edge(entry_place(), exit_place());
   }
 
+protected:
+  // NOTE: the net gets the given ID and entry and exit places which are not
+  //       stored yet, see SharedSubnetCN
+  PluginCNBase(const NetArenaRef &arena, ID id, Place &entry, Place &exit)
+    : CommunicationNet(arena, id), entry_p_(&entry), exit_p_(&exit) { }
+
+  static string operand_name(const Value &v) {
+    string str;
+    raw_string_ostream rso(str);
+    v.printAsOperand(rso, false);
+    return rso.str();
+  }
+
 private:
   template <typename PluggableCN>
   void plug_in_(PluggableCN &pcn) {
@@ -1037,16 +1484,7 @@ struct BasicBlockCN final : public PluginCNBase {
 
   ~BasicBlockCN() = default;
 
-  BasicBlockCN(BasicBlock const *bb) : bb(bb) {
-
-    string str;
-    raw_string_ostream rso(str);
-    bb->printAsOperand(rso, false);
-    string bb_name = " " + rso.str();
-
-    entry_place().name += bb_name;
-    exit_place().name += bb_name;
-  }
+  BasicBlockCN(BasicBlock const *bb) : PluginCNBase(" " + operand_name(*bb)), bb(bb) { }
 
   BasicBlockCN(const BasicBlockCN &) = delete;
   BasicBlockCN(BasicBlockCN &&) = default;
@@ -1068,6 +1506,18 @@ struct BasicBlockCN final : public PluginCNBase {
     plug_in_(acn);
   }
 
+  // NOTE: The net is connected to `acn`, but its elements are passed over
+  //       to `part`, which is streamed out separately (see DotStream).
+  //       The emptied block drops its plug-in nets and refers to the arena
+  //       of `acn`, hence all the memory of the block (including the edges
+  //       made by `connect`) is released with `part`.
+  void inject_into(AddressableCN &acn, CommunicationNet &part) && {
+    connect(acn);
+    plug_in_(part);
+    vector<PluginCNGeneric>().swap(stored_pcns_);
+    rebind_arena_(acn.arena());
+  }
+
   // NOTE: As the BasicBlockCN is only an envelope for inner CNs
   //       it needs to keep them separate. Therefore these are added only,
   //       and not injected directly.
@@ -1113,14 +1563,8 @@ struct CFG_CN final : public PluginCNBase {
 
   ~CFG_CN() = default;
 
-  CFG_CN(const Function &fn, LoopInfo &loop_info) : fn(fn), loop_info(loop_info) {
-    string str;
-    raw_string_ostream rso(str);
-    fn.printAsOperand(rso, false);
-    string fn_name = " " + rso.str();
-
-    entry_place().name += fn_name;
-    exit_place().name += fn_name;
+  CFG_CN(const Function &fn, LoopInfo &loop_info)
+    : PluginCNBase(" " + operand_name(fn)), fn(fn), loop_info(loop_info) {
 
     // create the basic structure
     auto bfs_it = breadth_first(&fn);
@@ -1229,10 +1673,10 @@ private:
     // change the entry place of loop branch
     // this will collapse with exit place of header loop
     Place &entry_p = bbcn.entry_place();
-    std::string entry_name = entry_p.name;
+    std::string entry_name = entry_p.name.str();
 
-    entry_p.type = "Bool";
-    entry_p.name = "";
+    entry_p.type = bbcn.intern("Bool");
+    entry_p.name = Symbol();
 
     // trigger the loop branch
     Transition &trigger_branch = bbcn.add_transition(ConditionList());
@@ -1255,8 +1699,8 @@ private:
         // change the type of exit place as the loop header
         // represents the condition in the CFG structure
         Place &exit_p = bbcn.exit_place();
-        exit_p.type = "Bool";
-        exit_p.name = "test_loop " + bbcn.get_id();
+        exit_p.type = bbcn.intern("Bool");
+        exit_p.name = bbcn.intern("test_loop " + std::to_string(bbcn.get_id()));
 
         // Body of the loop
         auto *loop_latch = loop->getLoopLatch();
@@ -0,0 +1,273 @@
+
+//===----------------------------------------------------------------------===//
+//
+// FrozenNet
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef MRPH_FROZEN_NET_H
+#define MRPH_FROZEN_NET_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/iterator_range.h"
+
+#include "morpheus/ADT/CommunicationNet.hpp"
+#include "morpheus/ADT/SymbolTable.hpp"
+
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+namespace cn {
+using namespace llvm;
+
+// FrozenNet is a read-only snapshot of an assembled AddressableCN. Unlike
+// the net itself, where each element is a separate object with edge vectors
+// of its own, the snapshot keeps the attributes of places, transitions and
+// edges in contiguous arrays and the outgoing edges in the CSR form. Hence
+// the passes over a complete net (e.g. printing) walk through the memory
+// sequentially.
+//
+// The nodes are numbered in the order: interface places of the ACN, places
+// and transitions of the embedded net. The outgoing edges of a node are
+// sorted by category and the edges of a category keep their order from the
+// net, so the snapshot prints the same as the net.
+//
+// The snapshot is immutable, so it can be shared by any number of views
+// (e.g. `shared_ptr<const FrozenNet>`) instead of being copied. A view that
+// modifies the net (collapse, reduction, ...) thaws the snapshot into a new
+// AddressableCN, only then the elements are copied. The thawed net is equal
+// to the frozen one including the IDs and the order of edges, hence it is
+// transformed the same way.
+//
+// NOTE: Unresolved elements are not part of the snapshot, the net is
+//       expected to be resolved.
+class FrozenNet final : public Printable<FrozenNet> {
+
+public:
+  using ID = Identifiable::ID;
+  using Index = uint32_t;
+
+  class NodeRef;
+  class PlaceRef;
+  class TransitionRef;
+  class EdgeRef;
+
+  // iterates over consecutive nodes or edges
+  template <typename Ref>
+  class ref_iterator {
+    const FrozenNet *net_;
+    Index index_;
+
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Ref;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const Ref *;
+    using reference = Ref;
+
+    ref_iterator(const FrozenNet &net, Index index) : net_(&net), index_(index) { }
+
+    Ref operator*() const { return Ref(*net_, index_); }
+
+    ref_iterator& operator++() {
+      ++index_;
+      return *this;
+    }
+
+    ref_iterator operator++(int) {
+      ref_iterator tmp(*this);
+      ++index_;
+      return tmp;
+    }
+
+    bool operator==(const ref_iterator &it) const { return index_ == it.index_; }
+    bool operator!=(const ref_iterator &it) const { return index_ != it.index_; }
+  };
+
+  template <typename Ref>
+  using ref_range = iterator_range<ref_iterator<Ref>>;
+
+  // -------------------------------------------------------
+  // references to the parts of the snapshot
+
+  class NodeRef {
+
+  public:
+    NodeRef(const FrozenNet &net, Index index) : net_(&net), index_(index) { }
+
+    ID get_id() const { return net_->ids_[index_]; }
+    Symbol name() const { return net_->names_[index_]; }
+    bool is_place() const { return index_ < net_->places_end_; }
+
+    // all the outgoing edges, the regular ones first
+    ref_range<EdgeRef> leads_to() const {
+      return net_->edges_(net_->out_offsets_[2 * index_],
+                          net_->out_offsets_[2 * index_ + 2]);
+    }
+
+    ref_range<EdgeRef> leads_to(EdgeCategory category) const {
+      return net_->edges_(net_->out_offsets_[2 * index_ + category],
+                          net_->out_offsets_[2 * index_ + category + 1]);
+    }
+
+  protected:
+    const FrozenNet *net_;
+    Index index_;
+  };
+
+  class PlaceRef final : public NodeRef {
+
+  public:
+    PlaceRef(const FrozenNet &net, Index index) : NodeRef(net, index) { }
+
+    // NOTE: places are the first nodes, hence their indices are shared
+    Symbol type() const { return net_->types_[index_]; }
+    Symbol init_expr() const { return net_->init_exprs_[index_]; }
+  };
+
+  class TransitionRef final : public NodeRef {
+
+  public:
+    TransitionRef(const FrozenNet &net, Index index) : NodeRef(net, index) { }
+
+    ArrayRef<Symbol> guard() const {
+      Index t = index_ - net_->places_end_;
+      Index begin = net_->guard_offsets_[t];
+      return makeArrayRef(net_->guards_).slice(begin, net_->guard_offsets_[t + 1] - begin);
+    }
+  };
+
+  class EdgeRef final {
+
+  public:
+    EdgeRef(const FrozenNet &net, Index index) : net_(&net), index_(index) { }
+
+    NodeRef startpoint() const { return NodeRef(*net_, net_->startpoints_[index_]); }
+    NodeRef endpoint() const { return NodeRef(*net_, net_->endpoints_[index_]); }
+    Symbol arc_expr() const { return net_->arc_exprs_[index_]; }
+    EdgeCategory get_category() const { return net_->categories_[index_]; }
+    EdgeType get_type() const { return net_->types_of_edges_[index_]; }
+
+  private:
+    const FrozenNet *net_;
+    Index index_;
+  };
+
+  // -------------------------------------------------------
+  // FrozenNet public API
+
+  explicit FrozenNet(const AddressableCN &acn);
+  FrozenNet(const FrozenNet &) = delete;
+  FrozenNet(FrozenNet &&) = default;
+  FrozenNet& operator=(const FrozenNet &) = delete;
+  FrozenNet& operator=(FrozenNet &&) = default;
+
+  ID get_id() const { return id_; }
+  ID get_embedded_id() const { return embedded_id_; }
+  AddressableCN::Address address() const { return address_; }
+
+  ref_range<PlaceRef> interface_places() const {
+    return make_range(ref_iterator<PlaceRef>(*this, 0),
+                      ref_iterator<PlaceRef>(*this, interface_end_));
+  }
+
+  // places of the embedded net
+  ref_range<PlaceRef> places() const {
+    return make_range(ref_iterator<PlaceRef>(*this, interface_end_),
+                      ref_iterator<PlaceRef>(*this, places_end_));
+  }
+
+  // transitions of the embedded net
+  ref_range<TransitionRef> transitions() const {
+    return make_range(ref_iterator<TransitionRef>(*this, places_end_),
+                      ref_iterator<TransitionRef>(*this, ids_.size()));
+  }
+
+  size_t nodes_size() const { return ids_.size(); }
+  size_t edges_size() const { return endpoints_.size(); }
+
+  // the bounds of the node indices (see the numbering above), e.g. to split
+  // the nodes into ranges printed separately
+  Index interface_end() const { return interface_end_; }
+  Index places_end() const { return places_end_; }
+
+  // creates a modifiable copy of the net
+  AddressableCN thaw() const {
+    return AddressableCN(*this);
+  }
+
+private:
+  FrozenNet() = default; // see BinaryNetReader
+
+  ThawedElements thaw_elements_() const;
+  void restore_(AddressableCN &acn, ThawedElements &&elements) const;
+
+  ref_range<EdgeRef> edges_(Index begin, Index end) const {
+    return make_range(ref_iterator<EdgeRef>(*this, begin),
+                      ref_iterator<EdgeRef>(*this, end));
+  }
+
+  ID id_;
+  ID embedded_id_;
+  AddressableCN::Address address_;
+  // the symbols are shared with the net
+  std::shared_ptr<SymbolTable> symbols_;
+
+  static constexpr Index NO_NODE = ~Index(0);
+
+  // the special places of ACN
+  Index asr_, arr_, csr_, crr_;
+  Index entry_, exit_; // NO_NODE if removed by a reduction
+
+  Index interface_end_ = 0; // the end of interface places
+  Index places_end_ = 0;    // the end of all the places
+
+  // nodes
+  std::vector<ID> ids_;
+  std::vector<Symbol> names_;
+  std::vector<Symbol> types_;                // of places
+  std::vector<Symbol> init_exprs_;           // of places
+  std::vector<Index> guard_offsets_;         // of transitions
+  std::vector<Symbol> guards_;
+
+  // outgoing edges of the node `n` and category `c` are
+  // [out_offsets_[2n + c], out_offsets_[2n + c + 1])
+  std::vector<Index> out_offsets_;
+
+  // edges referencing the node `n` are in_edges_[in_offsets_[n], in_offsets_[n + 1]),
+  // they keep the order of `referenced_by`
+  std::vector<Index> in_offsets_;
+  std::vector<Index> in_edges_;
+
+  // edges
+  std::vector<Index> startpoints_;
+  std::vector<Index> endpoints_;
+  std::vector<Symbol> arc_exprs_;
+  std::vector<EdgeCategory> categories_;
+  std::vector<EdgeType> types_of_edges_;
+
+  friend AddressableCN;
+  friend class BinaryNetReader; // the binary format, see BinaryNet.hpp
+  friend class BinaryNetWriter;
+};
+
+
+// ThawedElements are the nodes of a snapshot restored before the net itself,
+// as the special places of AddressableCN are bound by its constructor.
+struct ThawedElements {
+  NetArenaRef arena;
+  std::vector<Element<Place>> places;           // indexed as the nodes
+  std::vector<Element<Transition>> transitions; // indexed from the first transition
+};
+
+// Copies the net into a fresh arena. The arena never returns the memory of
+// removed elements, hence a net shrunk by `collapse` or `reduce` is copied
+// to release it once the original net is gone.
+inline AddressableCN compact(const AddressableCN &acn) {
+  return FrozenNet(acn).thaw();
+}
+
+} // end of communication net (cn) namespace
+
+#endif // MRPH_FROZEN_NET_H
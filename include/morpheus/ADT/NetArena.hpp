@@ -0,0 +1,118 @@
+
+//===----------------------------------------------------------------------===//
+//
+// NetArena
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef MRPH_NET_ARENA_H
+#define MRPH_NET_ARENA_H
+
+#include "llvm/Support/Allocator.h"
+
+#include "morpheus/ADT/SymbolTable.hpp"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace cn {
+
+// NetArena provides the memory for net elements (places, transitions, edges,
+// ...). The memory is never returned piece by piece, it is released in bulk
+// when the last net referring to the arena is gone. Hence the addresses of
+// elements remain stable regardless of the net they are moved into. The arena
+// also keeps the symbol table of the strings the elements refer.
+//
+// NOTE: The arena only owns the memory, the elements are still destroyed by
+//       their owners (see ArenaDeleter) as they own further resources.
+class NetArena {
+
+public:
+  ~NetArena() = default;
+
+  NetArena() : symbols_(SymbolTable::current()) { }
+  NetArena(const NetArena &) = delete;
+  NetArena(NetArena &&) = delete;
+  NetArena& operator=(const NetArena &) = delete;
+  NetArena& operator=(NetArena &&) = delete;
+
+  template <typename T, typename... Args>
+  T *create(Args&&... args) {
+    return new (allocator_.template Allocate<T>()) T(std::forward<Args>(args)...);
+  }
+
+  // Keeps the memory of `arena` alive as long as this arena lives. It is used
+  // when a net takes over the elements of another net.
+  // NOTE: nets are assembled bottom-up, so the adoption never forms a cycle.
+  //       The nets taken over one after another often share their arena
+  //       (e.g. the instances of SubnetTable), it is then adopted once.
+  void adopt(const std::shared_ptr<NetArena> &arena) {
+    if (arena && arena.get() != this && (adopted_.empty() || adopted_.back() != arena)) {
+      adopted_.push_back(arena);
+    }
+  }
+
+  SymbolTable &symbols() {
+    return *symbols_;
+  }
+
+  const std::shared_ptr<SymbolTable> &shared_symbols() const {
+    return symbols_;
+  }
+
+  size_t bytes_allocated() const {
+    return allocator_.getBytesAllocated();
+  }
+
+private:
+  // NOTE: most of the nets are small plugin nets with only a few elements,
+  //       hence the slabs are kept smaller than the default ones.
+  llvm::BumpPtrAllocatorImpl<llvm::MallocAllocator, 1024> allocator_;
+  std::vector<std::shared_ptr<NetArena>> adopted_;
+  std::shared_ptr<SymbolTable> symbols_;
+};
+
+
+// NetArenaRef is a shared reference to an arena. Unlike `shared_ptr`, moving
+// the reference does not empty the source. A net that has been taken over
+// may still create elements (e.g. edges made within `connect`) and these
+// have to be placed into the arena adopted by the new owner.
+class NetArenaRef {
+
+public:
+  NetArenaRef() : arena_(std::make_shared<NetArena>()) { }
+  NetArenaRef(const NetArenaRef &) = default;
+  NetArenaRef(NetArenaRef &&ref) : arena_(ref.arena_) { }
+  NetArenaRef& operator=(const NetArenaRef &) = default;
+  NetArenaRef& operator=(NetArenaRef &&ref) {
+    arena_ = ref.arena_;
+    return *this;
+  }
+
+  NetArena *operator->() const { return arena_.get(); }
+  NetArena &operator*() const { return *arena_; }
+
+  void adopt(const NetArenaRef &ref) {
+    arena_->adopt(ref.arena_);
+  }
+
+private:
+  std::shared_ptr<NetArena> arena_;
+};
+
+
+// ArenaDeleter only destroys the element, the memory belongs to the arena.
+template <typename T>
+struct ArenaDeleter {
+  void operator()(T *ptr) const {
+    ptr->~T();
+  }
+};
+
+template <typename T>
+using ArenaPtr = std::unique_ptr<T, ArenaDeleter<T>>;
+
+} // end of communication net (cn) namespace
+
+#endif // MRPH_NET_ARENA_H
@@ -0,0 +1,114 @@
+
+//===----------------------------------------------------------------------===//
+//
+// NetShape
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef MRPH_NET_SHAPE_H
+#define MRPH_NET_SHAPE_H
+
+#include "llvm/ADT/Hashing.h"
+
+#include "morpheus/ADT/CommunicationNet.hpp"
+#include "morpheus/ADT/SymbolTable.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace cn {
+using namespace llvm;
+
+// NetShape is the canonical structure of a net, i.e. the net without IDs
+// and names of its elements. The nets built the same way (e.g. plug-in nets
+// of two MPI_Send calls with the same arguments) have the same shape even
+// though their elements are named after the IDs of the nets.
+//
+// The nodes are ordered by the colours of Weisfeiler-Lehman refinement,
+// hence the shape does not depend on the order of elements within their
+// storage (e.g. reused slots). The hash is computed from the contents of
+// symbols, so it is the same for the nets of different symbol tables.
+// The digest identifies the shape across processes, e.g. to match the nets
+// generated for different ranks.
+//
+// NOTE: The edges leaving the net are kept without their endpoints, and
+//       the edges entering the net are part of the shape of the other net.
+//       Unresolved elements are only counted, as they refer to the IR.
+class NetShape final {
+
+public:
+  using Index = uint32_t;
+
+  static constexpr Index EXTERNAL = ~Index(0);
+
+  explicit NetShape(const CommunicationNet &net);
+  // NOTE: the shape of ACN covers the embedded net as well
+  explicit NetShape(const AddressableCN &acn);
+
+  hash_code hash() const { return hash_; }
+
+  // SHA-1 of the shape in the canonical order (40 hexadecimal digits),
+  // the shapes have the same digest iff they are equal
+  std::string digest() const;
+
+  size_t nodes_size() const { return kinds_.size(); }
+  size_t edges_size() const { return edges_.size(); }
+
+  // NOTE: the nodes with the same colours may be ordered differently within
+  //       two shapes of the same net, then the shapes are not equal. Hence
+  //       the comparison never equates two different structures, but it may
+  //       miss a symmetric one.
+  bool operator==(const NetShape &shape) const;
+  bool operator!=(const NetShape &shape) const { return !(*this == shape); }
+
+private:
+  struct EdgeShape {
+    Index startpoint;
+    Index endpoint; // EXTERNAL if the edge leaves the net
+    Symbol arc_expr;
+    EdgeCategory category;
+    EdgeType type;
+
+    bool operator==(const EdgeShape &e) const {
+      return (startpoint == e.startpoint && endpoint == e.endpoint &&
+              arc_expr == e.arc_expr && category == e.category && type == e.type);
+    }
+  };
+
+  // NOTE: long control flows would be refined node by node, the rounds are
+  //       limited as the colours of a few neighbourhoods already tell apart
+  //       the most of the nodes
+  static constexpr unsigned MAX_REFINEMENTS = 8;
+
+  void build_(const std::vector<const NetElement *> &nodes);
+
+  hash_code hash_;
+
+  // nodes in the canonical order
+  std::vector<NetElement::Kind> kinds_;
+  // type and initial expression of a place, guard of a transition
+  std::vector<Index> label_offsets_;
+  std::vector<Symbol> labels_;
+
+  // edges ordered by their startpoints, the outgoing edges of a node keep
+  // their order within each category
+  std::vector<EdgeShape> edges_;
+
+  size_t unresolved_places_ = 0;
+  size_t unresolved_transitions_ = 0;
+};
+
+inline hash_code hash_value(const NetShape &shape) {
+  return shape.hash();
+}
+
+// the structural hash of the net, see NetShape
+template <typename Net>
+hash_code structural_hash(const Net &net) {
+  return NetShape(net).hash();
+}
+
+} // end of communication net (cn) namespace
+
+#endif // MRPH_NET_SHAPE_H
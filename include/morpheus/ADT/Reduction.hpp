@@ -0,0 +1,106 @@
+
+//===----------------------------------------------------------------------===//
+//
+// Reduction
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef MRPH_REDUCTION_H
+#define MRPH_REDUCTION_H
+
+#include <cstddef>
+#include <ostream>
+
+namespace cn {
+
+// Reduction rules of nets, see CommunicationNet::reduce.
+enum struct Reduction : unsigned {
+  COLLAPSE,             // fusion of control flow chains of the same kind
+  PARALLEL_PATHS,       // removal of redundant control flow paths
+  SERIES_FUSION,        // fusion of transitions in series across a unit place
+  SELF_LOOPS,           // removal of self-loop edges and transitions
+  IDENTITY_TRANSITIONS, // removal of transitions passing a token unchanged
+  DEAD_PLACES,          // removal of places never marked and their transitions
+  EQUIVALENT_PLACES,    // merging of places with the same type and edges
+};
+
+constexpr unsigned REDUCTIONS_SIZE = 7;
+
+inline const char *reduction_name(Reduction rule) {
+  static const char *names[REDUCTIONS_SIZE] = {
+    "collapse",
+    "parallel-paths",
+    "series-fusion",
+    "self-loops",
+    "identity-transitions",
+    "dead-places",
+    "equivalent-places",
+  };
+  return names[static_cast<unsigned>(rule)];
+}
+
+
+// ReductionRules is a set of enabled rules.
+class ReductionRules final {
+
+public:
+  // NOTE: the bits are indexed by the rules
+  explicit ReductionRules(unsigned bits = 0) : bits_(bits) { }
+
+  static ReductionRules all() {
+    return ReductionRules((1u << REDUCTIONS_SIZE) - 1);
+  }
+
+  ReductionRules& enable(Reduction rule) {
+    bits_ |= bit_(rule);
+    return *this;
+  }
+
+  ReductionRules& disable(Reduction rule) {
+    bits_ &= ~bit_(rule);
+    return *this;
+  }
+
+  bool operator[](Reduction rule) const { return bits_ & bit_(rule); }
+  bool empty() const { return bits_ == 0; }
+
+private:
+  static unsigned bit_(Reduction rule) { return 1u << static_cast<unsigned>(rule); }
+
+  unsigned bits_;
+};
+
+
+// ReductionStats counts the applications of each rule and the elements
+// removed by the reduction.
+struct ReductionStats final {
+  size_t applied[REDUCTIONS_SIZE] = {};
+  size_t removed_places = 0;
+  size_t removed_transitions = 0;
+  size_t rounds = 0; // passes of all the enabled rules until the fixpoint
+
+  size_t& operator[](Reduction rule) { return applied[static_cast<unsigned>(rule)]; }
+  size_t operator[](Reduction rule) const { return applied[static_cast<unsigned>(rule)]; }
+
+  size_t total() const {
+    size_t sum = 0;
+    for (size_t a : applied) {
+      sum += a;
+    }
+    return sum;
+  }
+
+  friend std::ostream& operator<<(std::ostream &os, const ReductionStats &stats) {
+    for (unsigned r = 0; r < REDUCTIONS_SIZE; r++) {
+      os << reduction_name(static_cast<Reduction>(r)) << ": " << stats.applied[r] << "\n";
+    }
+    os << "removed places: " << stats.removed_places << "\n"
+       << "removed transitions: " << stats.removed_transitions << "\n"
+       << "rounds: " << stats.rounds << "\n";
+    return os;
+  }
+};
+
+} // end of communication net (cn) namespace
+
+#endif // MRPH_REDUCTION_H
@@ -0,0 +1,293 @@
+
+//===----------------------------------------------------------------------===//
+//
+// SlotMap
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef MRPH_SLOT_MAP_H
+#define MRPH_SLOT_MAP_H
+
+#include "llvm/ADT/SmallVector.h"
+
+#include "morpheus/ADT/NetArena.hpp"
+
+#include <cassert>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+
+namespace cn {
+
+// SlotSegment is a part of the storage of a SlotMap. The segments of spliced
+// maps are chained together and they form a union-find tree as well. The root
+// of the tree is the first segment of the map that holds them.
+class SlotSegment {
+
+public:
+  const SlotSegment *root() const {
+    const SlotSegment *segment = this;
+    while (segment->parent_) {
+      if (segment->parent_->parent_) { // path halving
+        segment->parent_ = segment->parent_->parent_;
+      }
+      segment = segment->parent_;
+    }
+    return segment;
+  }
+
+protected:
+  mutable const SlotSegment *parent_ = nullptr;
+
+  template <typename T>
+  friend class SlotMap;
+};
+
+
+// SlotHandle addresses an element stored within a SlotMap. The generation
+// distinguishes the element from the later occupants of the same slot.
+struct SlotHandle {
+  const SlotSegment *segment = nullptr;
+  uint32_t index = 0;
+  uint32_t generation = 0;
+
+  bool is_valid() const { return segment; }
+};
+
+
+// SlotMap stores arena allocated elements in slots of segments. Insertion,
+// removal and lookup by handle are constant time. Removed slots are reused,
+// each reuse bumps the generation of the slot and so the stale handles are
+// recognized.
+//
+// Two maps are spliced in constant time by chaining their segments, the
+// handles of the spliced elements remain valid. The small maps are copied
+// instead, as a chain of tiny segments would slow down the iteration.
+//
+// NOTE: Only the free slots of the last segment are reused. The slots are
+//       removed once the net is assembled, hence the segments spliced in
+//       earlier are rarely left with free slots.
+template <typename T>
+class SlotMap {
+
+  struct Slot {
+    ArenaPtr<T> elem;
+    uint32_t generation = 0;
+  };
+
+  // NOTE: most of the maps belong to small plugin nets, hence their slots
+  //       fit the segment itself
+  struct Segment final : public SlotSegment {
+    llvm::SmallVector<Slot, 4> slots;
+    llvm::SmallVector<uint32_t, 2> free;
+    Segment *next = nullptr;
+  };
+
+  // iterates over the occupied slots only
+  template <typename ElemRef>
+  class slot_iterator {
+    Segment *segment_;
+    size_t index_;
+
+    void skip_empty_() {
+      while (segment_) {
+        if (index_ < segment_->slots.size()) {
+          if (segment_->slots[index_].elem) {
+            return;
+          }
+          ++index_;
+        } else {
+          segment_ = segment_->next;
+          index_ = 0;
+        }
+      }
+    }
+
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = ArenaPtr<T>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = typename std::remove_reference<ElemRef>::type *;
+    using reference = ElemRef;
+
+    explicit slot_iterator(Segment *segment) : segment_(segment), index_(0) {
+      skip_empty_();
+    }
+
+    reference operator*() const { return segment_->slots[index_].elem; }
+    pointer operator->() const { return &segment_->slots[index_].elem; }
+
+    slot_iterator& operator++() {
+      ++index_;
+      skip_empty_();
+      return *this;
+    }
+
+    slot_iterator operator++(int) {
+      slot_iterator tmp(*this);
+      ++*this;
+      return tmp;
+    }
+
+    bool operator==(const slot_iterator &it) const {
+      return segment_ == it.segment_ && index_ == it.index_;
+    }
+    bool operator!=(const slot_iterator &it) const { return !(*this == it); }
+  };
+
+  Segment *segment_of_(SlotHandle handle) const {
+    return static_cast<Segment *>(const_cast<SlotSegment *>(handle.segment));
+  }
+
+  // maps up to this size are copied by splice
+  static constexpr size_t SMALL_MAP_SIZE = 64;
+
+public:
+  using iterator = slot_iterator<ArenaPtr<T> &>;
+  using const_iterator = slot_iterator<const ArenaPtr<T> &>;
+
+  ~SlotMap() {
+    clear();
+  }
+
+  SlotMap() = default;
+  SlotMap(const SlotMap &) = delete;
+  SlotMap(SlotMap &&map) : head_(map.head_), tail_(map.tail_), size_(map.size_) {
+    map.reset_();
+  }
+  SlotMap& operator=(const SlotMap &) = delete;
+  SlotMap& operator=(SlotMap &&map) {
+    if (this != &map) {
+      clear();
+      head_ = map.head_;
+      tail_ = map.tail_;
+      size_ = map.size_;
+      map.reset_();
+    }
+    return *this;
+  }
+
+  SlotHandle insert(ArenaPtr<T> &&elem) {
+    if (!tail_) {
+      head_ = tail_ = new Segment();
+    }
+
+    SlotHandle handle;
+    handle.segment = tail_;
+    if (tail_->free.empty()) {
+      handle.index = tail_->slots.size();
+      tail_->slots.emplace_back();
+    } else {
+      handle.index = tail_->free.back();
+      tail_->free.pop_back();
+    }
+
+    Slot &slot = tail_->slots[handle.index];
+    slot.elem = std::move(elem);
+    handle.generation = slot.generation;
+    size_++;
+    return handle;
+  }
+
+  // removes the element from the map and passes its ownership to the caller
+  ArenaPtr<T> take(SlotHandle handle) {
+    assert(is_live(handle) && "Stale or invalid handle to the slot map.");
+    assert(handle.segment->root() == head_ && "The handle belongs to another map.");
+
+    Segment *segment = segment_of_(handle);
+    Slot &slot = segment->slots[handle.index];
+    slot.generation++;
+    segment->free.push_back(handle.index);
+    size_--;
+    return std::move(slot.elem);
+  }
+
+  T& get(SlotHandle handle) const {
+    assert(is_live(handle) && "Stale or invalid handle to the slot map.");
+    return *segment_of_(handle)->slots[handle.index].elem;
+  }
+
+  // returns nullptr if the handle is stale
+  T* lookup(SlotHandle handle) const {
+    if (!is_live(handle)) {
+      return nullptr;
+    }
+    return segment_of_(handle)->slots[handle.index].elem.get();
+  }
+
+  // NOTE: the handle has to be issued by this map or a map spliced into it
+  bool is_live(SlotHandle handle) const {
+    if (!handle.is_valid()) {
+      return false;
+    }
+    const Segment *segment = segment_of_(handle);
+    return (handle.index < segment->slots.size() &&
+            segment->slots[handle.index].generation == handle.generation &&
+            segment->slots[handle.index].elem);
+  }
+
+  // checks whether the given element is stored under the handle
+  bool holds(const T &elem, SlotHandle handle) const {
+    return (handle.is_valid() &&
+            handle.segment->root() == head_ &&
+            is_live(handle) &&
+            segment_of_(handle)->slots[handle.index].elem.get() == &elem);
+  }
+
+  // Moves all the elements of `map` into this map. The segments of `map` are
+  // chained in constant time, only the elements of small maps are moved into
+  // the last segment one by one. The handles of the moved elements change,
+  // hence `relocate(elem, handle)` is called for each of them.
+  template <typename RelocateFn>
+  void splice(SlotMap &map, RelocateFn relocate) {
+    if (map.size_ <= SMALL_MAP_SIZE) {
+      for (ArenaPtr<T> &elem : map) {
+        T &e = *elem;
+        relocate(e, insert(std::move(elem)));
+      }
+      map.clear();
+      return;
+    }
+
+    if (head_) {
+      map.head_->parent_ = head_;
+      tail_->next = map.head_;
+    } else {
+      head_ = map.head_;
+    }
+    tail_ = map.tail_;
+    size_ += map.size_;
+    map.reset_();
+  }
+
+  void clear() {
+    while (head_) {
+      Segment *next = head_->next;
+      delete head_;
+      head_ = next;
+    }
+    reset_();
+  }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  iterator begin() { return iterator(head_); }
+  iterator end() { return iterator(nullptr); }
+  const_iterator begin() const { return const_iterator(head_); }
+  const_iterator end() const { return const_iterator(nullptr); }
+
+private:
+  void reset_() {
+    head_ = tail_ = nullptr;
+    size_ = 0;
+  }
+
+  Segment *head_ = nullptr;
+  Segment *tail_ = nullptr;
+  size_t size_ = 0;
+};
+
+} // end of communication net (cn) namespace
+
+#endif // MRPH_SLOT_MAP_H
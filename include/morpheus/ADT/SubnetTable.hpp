@@ -0,0 +1,150 @@
+
+//===----------------------------------------------------------------------===//
+//
+// SubnetTable
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef MRPH_SUBNET_TABLE_H
+#define MRPH_SUBNET_TABLE_H
+
+#include "morpheus/ADT/CommunicationNet.hpp"
+#include "morpheus/ADT/SymbolTable.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace cn {
+
+// SubnetShape is the frozen form of a plug-in net connected to an ACN. The
+// plug-in nets of the same MPI call differ only in the IDs of their elements
+// (and in the names built from the IDs), hence the shape keeps the IDs
+// relative to the ID of the net and the names split around the ID they
+// contain. The shape also keeps the order in which the edges have to be
+// created so that every element lists its edges as in the original net.
+struct SubnetShape final {
+
+  using ID = Identifiable::ID;
+  using Index = uint32_t;
+
+  struct Node {
+    NetElement::Kind kind;
+    ID id;               // relative to the ID of the net
+    // the name is `prefix + (ID of the net + number) + suffix`, or just
+    // `prefix` if the name does not contain any ID of the net
+    Symbol prefix;
+    Symbol suffix;
+    bool numbered;
+    ID number;
+    Symbol type;         // places only
+    Symbol init_expr;    // places only
+    Guard guard;         // transitions only
+
+    bool operator==(const Node &node) const;
+  };
+
+  // NOTE: the indices past the nodes refer to the interface places of ACN
+  //       in the order: asr, arr, csr, crr
+  struct EdgeShape {
+    Index startpoint;
+    Index endpoint;
+    Symbol arc_expr;
+    EdgeCategory category;
+    EdgeType type;
+
+    bool operator==(const EdgeShape &edge) const {
+      return startpoint == edge.startpoint && endpoint == edge.endpoint &&
+             arc_expr == edge.arc_expr && category == edge.category && type == edge.type;
+    }
+  };
+
+  // the nodes in the order of storage, places first
+  std::vector<Node> nodes;
+  std::vector<EdgeShape> edges; // in the order of creation
+  Index entry;
+  Index exit;
+  size_t hash = 0;
+
+  bool operator==(const SubnetShape &shape) const {
+    return hash == shape.hash && entry == shape.entry && exit == shape.exit &&
+           nodes == shape.nodes && edges == shape.edges;
+  }
+};
+
+
+// SharedSubnetCN is a plug-in net instantiated from a shared shape. Until
+// it is connected, the net holds only its entry and exit places, the other
+// elements are created by `connect` from the shape. The expanded net equals
+// the net the shape was taken from, including the IDs and the order of edges.
+//
+// NOTE: The net has to be connected before it is plugged in.
+struct SharedSubnetCN final : public PluginCNBase {
+
+  ~SharedSubnetCN() = default;
+
+  SharedSubnetCN(const NetArenaRef &arena, std::shared_ptr<const SubnetShape> shape,
+                 PluginCNBase &pcn);
+  SharedSubnetCN(const SharedSubnetCN &) = delete;
+  SharedSubnetCN(SharedSubnetCN &&) = default;
+
+  void connect(AddressableCN &acn) override;
+
+private:
+  std::shared_ptr<const SubnetShape> shape_;
+  // the entry and exit places until they are stored by `connect`
+  Element<Place> entry_;
+  Element<Place> exit_;
+};
+
+
+// SubnetTable hash-conses the shapes of plug-in nets. Each net passed to
+// `share` is frozen into its shape and replaced by an instance referring
+// the single copy of the shape in the table, so only the entry and exit
+// places of the instances are kept until the nets are connected. All the
+// instances are allocated in the arena of the table, which packs them more
+// tightly than the separate arenas of plug-in nets.
+//
+// A net is shared only if its elements and edges are all known before it
+// is plugged in, i.e. it has no unresolved elements and `connect` adds only
+// edges to the interface places of ACN. Other nets are kept as they are.
+//
+// NOTE: The IDs of the instances are taken from the frozen nets, hence the
+//       nets have to be created in the same order as without the table.
+class SubnetTable final {
+
+public:
+  SubnetTable();
+  SubnetTable(const SubnetTable &) = delete;
+  SubnetTable& operator=(const SubnetTable &) = delete;
+
+  template <typename PluggableCN>
+  PluginCNGeneric share(PluggableCN &&pcn) {
+    if (std::shared_ptr<const SubnetShape> shape = intern(pcn)) {
+      return SharedSubnetCN(arena_, std::move(shape), pcn);
+    }
+    return std::forward<PluggableCN>(pcn);
+  }
+
+  // returns the shape of the net within the table, or null if the net cannot be shared
+  std::shared_ptr<const SubnetShape> intern(PluginCNBase &pcn);
+
+  size_t instances_size() const { return instances_; }
+  size_t shapes_size() const { return shapes_size_; }
+
+private:
+  NetArenaRef arena_;
+  // the net the shapes are connected to, its IDs do not consume the IDs of nets
+  Identifiable::IDAllocator scratch_ids_;
+  std::unique_ptr<AddressableCN> scratch_;
+
+  std::unordered_map<size_t, std::vector<std::shared_ptr<const SubnetShape>>> shapes_;
+  size_t shapes_size_ = 0;
+  size_t instances_ = 0;
+};
+
+} // end of communication net (cn) namespace
+
+#endif // MRPH_SUBNET_TABLE_H
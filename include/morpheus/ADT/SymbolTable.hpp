@@ -0,0 +1,109 @@
+
+//===----------------------------------------------------------------------===//
+//
+// SymbolTable
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef MRPH_SYMBOL_TABLE_H
+#define MRPH_SYMBOL_TABLE_H
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Allocator.h"
+
+#include <memory>
+#include <ostream>
+#include <string>
+
+namespace cn {
+
+// Symbol is an interned string. The most of the strings within nets (types,
+// arc expressions, ...) are a few constants repeated all over the net, hence
+// the elements keep only a pointer to the single copy stored in SymbolTable.
+//
+// NOTE: The empty string is represented by the null symbol.
+class Symbol {
+
+  using Entry = llvm::StringMapEntry<char>;
+
+public:
+  Symbol() = default;
+
+  llvm::StringRef ref() const {
+    return entry_ ? entry_->getKey() : llvm::StringRef();
+  }
+
+  std::string str() const { return ref().str(); }
+
+  bool empty() const { return !entry_; }
+
+  // NOTE: the symbols of the same table are compared by pointers, the symbols
+  //       of different tables by their contents.
+  bool operator==(const Symbol &sym) const {
+    return entry_ == sym.entry_ || (entry_ && sym.entry_ && ref() == sym.ref());
+  }
+  bool operator!=(const Symbol &sym) const { return !(*this == sym); }
+
+  friend std::ostream& operator<<(std::ostream &os, const Symbol &sym) {
+    llvm::StringRef str = sym.ref();
+    return os.write(str.data(), str.size());
+  }
+
+private:
+  explicit Symbol(const Entry *entry) : entry_(entry) { }
+
+  const Entry *entry_ = nullptr;
+
+  friend class SymbolTable;
+};
+
+
+// SymbolTable keeps the interned strings of nets. Each NetArena holds its
+// table, so the symbols remain valid as long as the elements referring them.
+// The nets built by a thread share its default table, hence the strings
+// repeated across nets (e.g. "Unit") are stored once. `SymbolTable::Scope`
+// replaces the default table by another one, e.g. to release the strings
+// together with the nets built within the scope.
+//
+// NOTE: The table is not synchronized, it is used only by the thread that
+//       builds the nets.
+class SymbolTable {
+
+public:
+  SymbolTable() = default;
+  SymbolTable(const SymbolTable &) = delete;
+  SymbolTable& operator=(const SymbolTable &) = delete;
+
+  Symbol intern(llvm::StringRef str) {
+    if (str.empty()) {
+      return Symbol();
+    }
+    // NOTE: entries of StringMap are not relocated by rehashing
+    return Symbol(&*strings_.insert({str, 0}).first);
+  }
+
+  size_t size() const { return strings_.size(); }
+
+  // shares the table with the nets created by the current thread
+  // until the end of scope
+  struct Scope final {
+    explicit Scope(std::shared_ptr<SymbolTable> table);
+    ~Scope();
+    Scope(const Scope &) = delete;
+    Scope& operator=(const Scope &) = delete;
+
+  private:
+    std::shared_ptr<SymbolTable> previous_;
+  };
+
+  // returns the table of the current scope, or the default table of the thread
+  static std::shared_ptr<SymbolTable> current();
+
+private:
+  llvm::StringMap<char, llvm::BumpPtrAllocator> strings_;
+};
+
+} // end of communication net (cn) namespace
+
+#endif // MRPH_SYMBOL_TABLE_H
@@ -32,8 +32,7 @@ namespace llvm {
 
   private:
     enum ExplorationState {
-      PROCESSING = 0,
-      SEQUENTIAL,                  // 'sequential' < 'external' because unless proved otherwise
+      SEQUENTIAL = 0,              // 'sequential' < 'external' because unless proved otherwise
                                    // the function is supposed to be sequential.
       EXTERNAL,                    // indirect call cannot be analyzed what is inside
       MPI_CALL,
@@ -51,7 +50,9 @@ namespace llvm {
 
   public:
 
-    explicit MPILabelling(CallGraph &cg);
+    // NOTE: the call graph may be labelled by several threads (`jobs`),
+    //       the results are the same as by a single one
+    explicit MPILabelling(CallGraph &cg, unsigned jobs = 1);
     MPILabelling(const MPILabelling &labelling) = default;
     MPILabelling(MPILabelling &&labelling) = default;
 
@@ -63,7 +64,7 @@ namespace llvm {
 
   private:
 
-    ExplorationState explore_cgnode(CallGraphNode const *cgn);
+    class Labeller; // labels the SCCs of the call graph, see the source
     void save_checkpoint(CallSite cs, MPICallType call_type);
 
     template<ExplorationState STATE> bool check_status(Function const *f) const {
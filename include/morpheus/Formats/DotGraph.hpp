@@ -1,7 +1,8 @@
 
-#ifndef MORPH_PLAIN_TEXT_FMT
-#define MORPH_PLAIN_TEXT_FMT
+#ifndef MORPH_DOT_GRAPH_FMT
+#define MORPH_DOT_GRAPH_FMT
 
+#include "morpheus/ADT/FrozenNet.hpp"
 #include "morpheus/Formats/Formatter.hpp"
 
 #include <fstream>
@@ -18,71 +19,22 @@ namespace cn {
 
     public:
       ostream& format(ostream &os, const NetElement &net_elem) const {
-        if (!net_elem.name.empty()) {
-          os << net_elem.name;
-        }
-        return os;
+        return format_name_(os, net_elem.name);
       }
 
       ostream& format(ostream &os, const Edge &edge) const {
-        BasicBlockCN::EdgePredicate<CONTROL_FLOW> is_cf;
-        string color = "black";
-        if (is_cf(edge)) {
-          color = "gray";
-        }
-
-        os << edge.startpoint.get_id() << ":box:c"
-           << " -> "
-           << edge.endpoint.get_id() << ":box:c"
-           << " [label=\"" << edge.arc_expr << "\" color=\"" << color << "\" fontname=\"monospace\"];";
-
-        return os;
+        return format_edge_(os, edge.startpoint.get_id(), edge.endpoint.get_id(),
+                            edge.arc_expr, edge.get_category());
       }
 
       ostream& format(ostream &os, const Place &place) const {
-        string id = place.get_id();
-
-        os << place.get_id()
-           << " [shape=plain label=<"
-           << "<table border=\"0\">"
-            << "<tr>"
-             << "<td></td>"
-             << "<td align=\"left\" valign=\"top\" rowspan=\"2\">" << place.init_expr << "</td>"
-            << "</tr>"
-
-            << "<tr>"
-             << "<td port=\"box\" border=\"1\" cellpadding=\"10\" rowspan=\"2\" style=\"rounded\">"; format(os, static_cast<const NetElement&>(place)); os << "</td>"
-            << "</tr>"
-
-            << "<tr>"
-             << "<td align=\"left\" valign=\"bottom\" rowspan=\"2\">" << place.type << "</td>"
-            << "</tr>"
-
-            << "<tr>"
-             << "<td></td>"
-            << "</tr>"
-           << "</table>"
-           << ">];";
-
-        return os;
+        return format_place_(os, place.get_id(), place.name, place.type, place.init_expr);
       }
 
       ostream& format(ostream &os, const Transition &transition) const {
-        os << transition.get_id()
-           << " [shape=plain label=<"
-           << "<table border=\"0\">"
-            << "<tr>"
-             << "<td border=\"1\" cellpadding=\"10\" port=\"box\">"; format(os, static_cast<const NetElement &>(transition)); os << "</td>"
-            << "</tr>"
-            << "<tr>"
-             << "<td>" << pp_vector(transition.guard, ", ", "[", "]") << "</td>"
-            << "</tr>"
-           << "</table>"
-           << ">];";
-        return os;
+        return format_transition_(os, transition.get_id(), transition.name, transition.guard);
       }
 
-
       ostream& format(ostream &os, const CommunicationNet &cn) const {
         os << "subgraph cluster_CN" << cn.get_id() << "{\n";
 
@@ -132,17 +84,208 @@ namespace cn {
         os << "}";
         return os;
       }
+
+      // NOTE: the snapshot is printed the same as the net it was made of
+      ostream& format(ostream &os, const FrozenNet &net) const {
+        for (const NetPart &part : layout(net)) {
+          format(os, net, part, part.begin, part.end);
+        }
+        return os;
+      }
+
+      vector<NetPart> layout(const FrozenNet &net) const {
+        NetPart::Index nodes_end = net.nodes_size();
+        return {
+          NetPart::of_text("digraph ACN" + to_string(net.get_id()) + "{\n"),
+          NetPart::of_nodes(0, net.interface_end()),
+          // the embedded net
+          NetPart::of_text("subgraph cluster_CN" + to_string(net.get_embedded_id()) + "{\n"),
+          NetPart::of_nodes(net.interface_end(), nodes_end),
+          NetPart::of_text("}\n"),
+          // edges from the embedded CN and then the edges of the ACN
+          NetPart::of_edges(NetPart::EDGES, net.interface_end(), nodes_end),
+          NetPart::of_edges(NetPart::EDGES, 0, net.interface_end()),
+          NetPart::of_text("}"),
+        };
+      }
+
+      ostream& format(ostream &os, const FrozenNet &net, const NetPart &part,
+                      NetPart::Index begin, NetPart::Index end) const {
+        switch (part.kind) {
+          case NetPart::TEXT:
+            os << part.text;
+            break;
+
+          case NetPart::NODES:
+            for (NetPart::Index n = begin; n < end; ++n) {
+              if (n < net.places_end()) {
+                FrozenNet::PlaceRef p(net, n);
+                format_place_(os, p.get_id(), p.name(), p.type(), p.init_expr()) << "\n";
+              } else {
+                FrozenNet::TransitionRef t(net, n);
+                format_transition_(os, t.get_id(), t.name(), t.guard()) << "\n";
+              }
+            }
+            break;
+
+          case NetPart::EDGES:
+          case NetPart::REGULAR_EDGES:
+          case NetPart::CONTROL_FLOW_EDGES:
+            for (NetPart::Index n = begin; n < end; ++n) {
+              FrozenNet::NodeRef node(net, n);
+              auto edges = part.kind == NetPart::EDGES ? node.leads_to()
+                         : node.leads_to(part.kind == NetPart::REGULAR_EDGES ? REGULAR : CONTROL_FLOW);
+              for (const FrozenNet::EdgeRef &e : edges) {
+                format_edge_(os, e.startpoint().get_id(), e.endpoint().get_id(),
+                             e.arc_expr(), e.get_category()) << "\n";
+              }
+            }
+            break;
+        }
+        return os;
+      }
+
+    private:
+      using ID = Identifiable::ID;
+
+      ostream& format_name_(ostream &os, Symbol name) const {
+        if (!name.empty()) {
+          os << name;
+        }
+        return os;
+      }
+
+      ostream& format_edge_(ostream &os, ID startpoint, ID endpoint,
+                            Symbol arc_expr, EdgeCategory category) const {
+        const char *color = (category == CONTROL_FLOW) ? "gray" : "black";
+
+        os << startpoint << ":box:c -> "
+           << endpoint << ":box:c [label=\"" << arc_expr
+           << "\" color=\"" << color << "\" fontname=\"monospace\"];";
+
+        return os;
+      }
+
+      // NOTE: the adjacent literals are concatenated by the compiler, so
+      //       a place is written in a few pieces rather than tag by tag
+      ostream& format_place_(ostream &os, ID id, Symbol name, Symbol type, Symbol init_expr) const {
+        os << id
+           << " [shape=plain label=<"
+              "<table border=\"0\">"
+               "<tr>"
+                "<td></td>"
+                "<td align=\"left\" valign=\"top\" rowspan=\"2\">" << init_expr << "</td>"
+               "</tr>"
+
+               "<tr>"
+                "<td port=\"box\" border=\"1\" cellpadding=\"10\" rowspan=\"2\" style=\"rounded\">"; format_name_(os, name); os << "</td>"
+               "</tr>"
+
+               "<tr>"
+                "<td align=\"left\" valign=\"bottom\" rowspan=\"2\">" << type << "</td>"
+               "</tr>"
+
+               "<tr>"
+                "<td></td>"
+               "</tr>"
+              "</table>"
+              ">];";
+
+        return os;
+      }
+
+      template <typename Guard>
+      ostream& format_transition_(ostream &os, ID id, Symbol name, const Guard &guard) const {
+        os << id
+           << " [shape=plain label=<"
+              "<table border=\"0\">"
+               "<tr>"
+                "<td border=\"1\" cellpadding=\"10\" port=\"box\">"; format_name_(os, name); os << "</td>"
+               "</tr>"
+               "<tr>"
+                "<td>" << pp_vector(guard, ", ", "[", "]") << "</td>"
+               "</tr>"
+              "</table>"
+              ">];";
+        return os;
+      }
+    };
+
+
+    // =========================================================================
+    // DotStream
+
+    // DotStream writes an AddressableCN while it is being built. A complete
+    // part of the embedded net is written as soon as it is done and it is
+    // released afterwards. The parts with unresolved elements are kept
+    // pending until they are resolved within the assembled net.
+    //
+    // NOTE: The embedded net is written as a series of subgraphs of the same
+    //       name, which Graphviz merges into a single cluster.
+    class DotStream final {
+
+    public:
+      DotStream(ostream &os, const AddressableCN &acn)
+        : os_(os), embedded_id_(acn.embedded_cn.get_id()) {
+        os_ << "digraph ACN" << acn.get_id() << "{\n";
+        for (const auto &p : acn.places()) {
+          fmt_.format(os_, *p) << "\n";
+        }
+      }
+      DotStream(const DotStream &) = delete;
+      DotStream& operator=(const DotStream &) = delete;
+
+      // writes the part unless it has unresolved elements
+      void write(CommunicationNet part) {
+        if (part.has_unresolved()) {
+          pending_.push_back(move(part));
+        } else {
+          flush_(part);
+        }
+      }
+
+      // passes over the pending parts to be taken over by the assembled net
+      vector<CommunicationNet> take_pending() {
+        return move(pending_);
+      }
+
+      // writes the rest of the assembled net
+      void close(AddressableCN &acn) {
+        flush_(acn.embedded_cn);
+        acn.release_edges([this](const Edge &e) { fmt_.format(os_, e) << "\n"; });
+        os_ << "}";
+      }
+
+    private:
+      void flush_(CommunicationNet &part) {
+        os_ << "subgraph cluster_CN" << embedded_id_ << "{\n";
+        for (const auto &p : part.places()) {
+          fmt_.format(os_, *p) << "\n";
+        }
+        for (const auto &t : part.transitions()) {
+          fmt_.format(os_, *t) << "\n";
+        }
+        os_ << "}\n";
+
+        // NOTE: the edges leading to the other parts are written only once,
+        //       as they are removed from both their ends
+        part.release_edges([this](const Edge &e) { fmt_.format(os_, e) << "\n"; });
+        part.clear();
+      }
+
+      ostream &os_;
+      Identifiable::ID embedded_id_;
+      DotGraph fmt_;
+      vector<CommunicationNet> pending_;
     };
 
   } // end of formats namespace
 
   template <typename T>
   ofstream &operator<< (ofstream &fs, const Printable<T> &printable) {
-    std::stringstream ss;
-    printable.print(ss, formats::DotGraph());
-    fs << ss.str();
+    printable.print(fs, formats::DotGraph());
     return fs;
   }
 } // end of cn namespace
 
-# endif // MORPH_PLAIN_TEXT_FMT
+# endif // MORPH_DOT_GRAPH_FMT
@@ -4,8 +4,15 @@
 
 #include "morpheus/ADT/CommunicationNet.hpp"
 
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <cstdint>
 #include <ostream>
 #include <memory>
+#include <streambuf>
+#include <string>
+#include <vector>
 
 namespace cn {
 
@@ -16,6 +23,7 @@ namespace cn {
   struct Transition;
   class  CommunicationNet;
   struct AddressableCN;
+  class  FrozenNet;
 
   namespace formats {
 
@@ -24,6 +32,38 @@ namespace cn {
       SUBGRAPH,
     };
 
+    // NetPart is a piece of a printed FrozenNet: a fixed text, the nodes of
+    // a range or the outgoing edges of the nodes of a range. A formatter
+    // describes a snapshot by the list of its parts, so that the ranges can
+    // be split and printed separately (see ShardedWriter).
+    struct NetPart {
+      enum Kind {
+        TEXT,
+        NODES,
+        EDGES,              // all the outgoing edges
+        REGULAR_EDGES,
+        CONTROL_FLOW_EDGES,
+      };
+
+      using Index = uint32_t;
+
+      Kind kind;
+      std::string text;
+      Index begin = 0, end = 0; // the range of node indices
+
+      static NetPart of_text(std::string text) {
+        return {TEXT, std::move(text)};
+      }
+
+      static NetPart of_nodes(Index begin, Index end) {
+        return {NODES, "", begin, end};
+      }
+
+      static NetPart of_edges(Kind kind, Index begin, Index end) {
+        return {kind, "", begin, end};
+      }
+    };
+
     struct Formatter {
       virtual std::ostream& format(std::ostream &os, const NetElement &) const = 0;
       virtual std::ostream& format(std::ostream &os, const Edge &) const = 0;
@@ -31,29 +71,81 @@ namespace cn {
       virtual std::ostream& format(std::ostream &os, const Transition &) const = 0;
       virtual std::ostream& format(std::ostream &os, const CommunicationNet &) const = 0;
       virtual std::ostream& format(std::ostream &os, const AddressableCN &) const = 0;
+      virtual std::ostream& format(std::ostream &os, const FrozenNet &) const = 0;
+
+      // the parts of the printed snapshot in the order of the output
+      virtual std::vector<NetPart> layout(const FrozenNet &) const = 0;
+      // prints the nodes [begin, end) of the part, the whole part is printed
+      // by the range [part.begin, part.end)
+      virtual std::ostream& format(std::ostream &os, const FrozenNet &,
+                                   const NetPart &part,
+                                   NetPart::Index begin, NetPart::Index end) const = 0;
     };
 
 
     // -------------------------------------------------------------------------
     // utilities
 
-    template <typename T>
-    auto create_print_fn_(std::ostream &os, const Formatter &fmt,
-                          std::string delim, size_t pos) {
-      return [&, pos] (const std::unique_ptr<T> &e) {
-        os << std::string(pos, ' ');
-        fmt.format(os, *e);
+    // RawStreamBuf lets the formatters write into a raw_ostream. It has no
+    // buffer of its own, the fragments are appended straight to the buffer
+    // of the raw_ostream, so a net is never formatted into a temporary copy.
+    class RawStreamBuf final : public std::streambuf {
+    public:
+      explicit RawStreamBuf(llvm::raw_ostream &os) : os_(os) { }
+
+    protected:
+      std::streamsize xsputn(const char *s, std::streamsize n) override {
+        os_.write(s, n);
+        return n;
+      }
+
+      int_type overflow(int_type c) override {
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+          os_ << traits_type::to_char_type(c);
+        }
+        return traits_type::not_eof(c);
+      }
+
+      int sync() override {
+        os_.flush();
+        return 0;
+      }
+
+    private:
+      llvm::raw_ostream &os_;
+    };
+
+    inline void write_indent_(std::ostream &os, size_t pos) {
+      static constexpr char spaces[] = "                ";
+      while (pos > 0) {
+        size_t n = std::min(pos, sizeof(spaces) - 1);
+        os.write(spaces, n);
+        pos -= n;
+      }
+    }
+
+    // NOTE: The formatter is a template parameter, hence a formatter passing
+    //       itself (`*this`) formats the elements by direct calls the compiler
+    //       can inline, as the formatters are final. A formatter passed as
+    //       `const Formatter &` keeps the virtual dispatch. The elements are
+    //       formatted as `T`, whatever (smart) pointer refers to them.
+    template <typename T, typename Fmt>
+    auto create_print_fn_(std::ostream &os, const Fmt &fmt,
+                          const char *delim, size_t pos) {
+      return [&os, &fmt, delim, pos] (const auto &e) {
+        write_indent_(os, pos);
+        fmt.format(os, static_cast<const T &>(*e));
         os << delim;
       };
     }
 
-    template <typename T, typename UnaryPredicate>
-    auto create_print_fn_(std::ostream &os, const Formatter &fmt,
-                          UnaryPredicate pred, std::string delim, size_t pos) {
-      return [&, pred, pos] (const std::unique_ptr<T> &e) {
+    template <typename T, typename Fmt, typename UnaryPredicate>
+    auto create_print_fn_(std::ostream &os, const Fmt &fmt,
+                          UnaryPredicate pred, const char *delim, size_t pos) {
+      return [&os, &fmt, pred, delim, pos] (const auto &e) {
         if (pred(*e)) {
-          os << std::string(pos, ' ');
-          fmt.format(os, *e);
+          write_indent_(os, pos);
+          fmt.format(os, static_cast<const T &>(*e));
           os << delim;
         }
       };
@@ -2,10 +2,13 @@
 #ifndef MORPH_PLAIN_TEXT_FMT
 #define MORPH_PLAIN_TEXT_FMT
 
+#include "morpheus/ADT/FrozenNet.hpp"
 #include "morpheus/Formats/Formatter.hpp"
 
 #include "llvm/Support/raw_ostream.h"
 
+#include <sstream>
+
 using namespace std;
 
 namespace cn {
@@ -15,52 +18,19 @@ namespace cn {
 
     public:
       ostream& format(ostream &os, const NetElement &net_elem) const {
-        if (net_elem.name.empty()) {
-          os << this; // print pointer value
-        } else {
-          os << net_elem.name;
-        }
-        return os;
+        return format_name_(os, net_elem.name);
       }
 
       ostream& format(ostream &os, const Edge &edge) const {
-        format(os, edge.startpoint);
-        if (edge.arc_expr.empty()) {
-          os << " -> ";
-        } else {
-          os << " --/ " << edge.arc_expr << " /--> ";
-        }
-        // os << edge.endpoint;
-        format(os, edge.endpoint);
-        return os;
+        return format_edge_(os, edge.startpoint.name, edge.endpoint.name, edge.arc_expr);
       }
 
       ostream& format(ostream &os, const Place &place) const {
-        os << "P(" << place.get_id() << "): ";
-
-        format(os, static_cast<const NetElement&>(place));
-
-        os << "<";
-        if (!place.type.empty()) {
-          os << place.type;
-        }
-        os << ">";
-
-        os << "[";
-        if (!place.init_expr.empty()) {
-          os << place.init_expr;
-        }
-        os << "]";
-        return os;
+        return format_place_(os, place.get_id(), place.name, place.type, place.init_expr);
       }
 
       ostream& format(ostream &os, const Transition &transition) const {
-        os << "T(" << transition.get_id() << "): ";
-
-        format(os, static_cast<const NetElement&>(transition));
-
-        os << pp_vector(transition.guard, ", ", "[", "]");
-        return os;
+        return format_transition_(os, transition.get_id(), transition.name, transition.guard);
       }
 
       ostream& format(ostream &os, const CommunicationNet &cn) const {
@@ -95,60 +65,188 @@ namespace cn {
 
         os << "Input edges:\n";
         for (const auto &p : acn.embedded_cn.places()) {
-          std::for_each(
-            p->leads_to.begin(),
-            p->leads_to.end(),
-            create_print_fn_<Edge>(
-              os, *this, CommunicationNet::EdgePredicate<REGULAR>(), "\n", 2));
+          auto &edges = p->leads_to.of(REGULAR);
+          std::for_each(edges.begin(),
+                        edges.end(),
+                        create_print_fn_<Edge>(os, *this, "\n", 2));
         }
         for (const auto &p : acn.places()) {
-          std::for_each(
-            p->leads_to.begin(),
-            p->leads_to.end(),
-            create_print_fn_<Edge>(
-              os, *this, CommunicationNet::EdgePredicate<REGULAR>(), "\n", 2));
+          auto &edges = p->leads_to.of(REGULAR);
+          std::for_each(edges.begin(),
+                        edges.end(),
+                        create_print_fn_<Edge>(os, *this, "\n", 2));
         }
 
         os << "Outuput edges:\n";
         for (const auto &t : acn.embedded_cn.transitions()) {
-          std::for_each(t->leads_to.begin(),
-                        t->leads_to.end(),
-                        create_print_fn_<Edge>(
-                          os, *this, CommunicationNet::EdgePredicate<REGULAR>(), "\n", 2));
+          auto &edges = t->leads_to.of(REGULAR);
+          std::for_each(edges.begin(),
+                        edges.end(),
+                        create_print_fn_<Edge>(os, *this, "\n", 2));
         }
 
         os << "CF edges: \n";
         for (const auto &p : acn.places()) {
-          std::for_each(
-            p->leads_to.begin(),
-            p->leads_to.end(),
-            create_print_fn_<Edge>(
-              os, *this, CommunicationNet::EdgePredicate<CONTROL_FLOW>(), "\n", 2));
+          auto &edges = p->leads_to.of(CONTROL_FLOW);
+          std::for_each(edges.begin(),
+                        edges.end(),
+                        create_print_fn_<Edge>(os, *this, "\n", 2));
         }
         for (const auto &p : acn.embedded_cn.places()) {
-          std::for_each(p->leads_to.begin(),
-                        p->leads_to.end(),
-                        create_print_fn_<Edge>(
-                          os, *this, CommunicationNet::EdgePredicate<CONTROL_FLOW>(), "\n", 2));
+          auto &edges = p->leads_to.of(CONTROL_FLOW);
+          std::for_each(edges.begin(),
+                        edges.end(),
+                        create_print_fn_<Edge>(os, *this, "\n", 2));
         }
         for (const auto &t : acn.embedded_cn.transitions()) {
-          std::for_each(t->leads_to.begin(),
-                        t->leads_to.end(),
-                        create_print_fn_<Edge>(
-                          os, *this, CommunicationNet::EdgePredicate<CONTROL_FLOW>(), "\n", 2));
+          auto &edges = t->leads_to.of(CONTROL_FLOW);
+          std::for_each(edges.begin(),
+                        edges.end(),
+                        create_print_fn_<Edge>(os, *this, "\n", 2));
         }
         os << "----------------------------------------\n";
         return os;
       }
+
+      // NOTE: the snapshot is printed the same as the net it was made of
+      ostream& format(ostream &os, const FrozenNet &net) const {
+        for (const NetPart &part : layout(net)) {
+          format(os, net, part, part.begin, part.end);
+        }
+        return os;
+      }
+
+      vector<NetPart> layout(const FrozenNet &net) const {
+        NetPart::Index interface_end = net.interface_end();
+        NetPart::Index places_end = net.places_end();
+        NetPart::Index nodes_end = net.nodes_size();
+
+        std::stringstream header;
+        header << "Address: " << net.address() << "\n"
+               << "----------------------------------------\n"
+               << "Interface places:";
+
+        return {
+          NetPart::of_text(header.str()),
+          NetPart::of_nodes(0, interface_end),
+          // the embedded communication net
+          NetPart::of_text("CommunicationNet(" + to_string(net.get_embedded_id()) + "):\n"
+                           "Places:\n"),
+          NetPart::of_nodes(interface_end, places_end),
+          NetPart::of_text("Transitions:\n"),
+          NetPart::of_nodes(places_end, nodes_end),
+
+          NetPart::of_text("Input edges:\n"),
+          NetPart::of_edges(NetPart::REGULAR_EDGES, interface_end, places_end),
+          NetPart::of_edges(NetPart::REGULAR_EDGES, 0, interface_end),
+
+          NetPart::of_text("Outuput edges:\n"),
+          NetPart::of_edges(NetPart::REGULAR_EDGES, places_end, nodes_end),
+
+          // interface places, places and transitions
+          NetPart::of_text("CF edges: \n"),
+          NetPart::of_edges(NetPart::CONTROL_FLOW_EDGES, 0, nodes_end),
+          NetPart::of_text("----------------------------------------\n"),
+        };
+      }
+
+      ostream& format(ostream &os, const FrozenNet &net, const NetPart &part,
+                      NetPart::Index begin, NetPart::Index end) const {
+        switch (part.kind) {
+          case NetPart::TEXT:
+            os << part.text;
+            break;
+
+          case NetPart::NODES:
+            for (NetPart::Index n = begin; n < end; ++n) {
+              os << "  ";
+              if (n < net.places_end()) {
+                FrozenNet::PlaceRef p(net, n);
+                format_place_(os, p.get_id(), p.name(), p.type(), p.init_expr()) << "\n";
+              } else {
+                FrozenNet::TransitionRef t(net, n);
+                format_transition_(os, t.get_id(), t.name(), t.guard()) << "\n";
+              }
+            }
+            break;
+
+          case NetPart::EDGES:
+          case NetPart::REGULAR_EDGES:
+          case NetPart::CONTROL_FLOW_EDGES:
+            for (NetPart::Index n = begin; n < end; ++n) {
+              FrozenNet::NodeRef node(net, n);
+              auto edges = part.kind == NetPart::EDGES ? node.leads_to()
+                         : node.leads_to(part.kind == NetPart::REGULAR_EDGES ? REGULAR : CONTROL_FLOW);
+              for (const FrozenNet::EdgeRef &e : edges) {
+                os << "  ";
+                format_edge_(os, e.startpoint().name(), e.endpoint().name(), e.arc_expr()) << "\n";
+              }
+            }
+            break;
+        }
+        return os;
+      }
+
+    private:
+      using ID = Identifiable::ID;
+
+      ostream& format_name_(ostream &os, Symbol name) const {
+        if (name.empty()) {
+          os << this; // print pointer value
+        } else {
+          os << name;
+        }
+        return os;
+      }
+
+      ostream& format_edge_(ostream &os, Symbol startpoint, Symbol endpoint, Symbol arc_expr) const {
+        format_name_(os, startpoint);
+        if (arc_expr.empty()) {
+          os << " -> ";
+        } else {
+          os << " --/ " << arc_expr << " /--> ";
+        }
+        format_name_(os, endpoint);
+        return os;
+      }
+
+      ostream& format_place_(ostream &os, ID id, Symbol name, Symbol type, Symbol init_expr) const {
+        os << "P(" << id << "): ";
+
+        format_name_(os, name);
+
+        os << "<";
+        if (!type.empty()) {
+          os << type;
+        }
+        os << ">";
+
+        os << "[";
+        if (!init_expr.empty()) {
+          os << init_expr;
+        }
+        os << "]";
+        return os;
+      }
+
+      template <typename Guard>
+      ostream& format_transition_(ostream &os, ID id, Symbol name, const Guard &guard) const {
+        os << "T(" << id << "): ";
+
+        format_name_(os, name);
+
+        os << pp_vector(guard, ", ", "[", "]");
+        return os;
+      }
     };
 
   } // end of formats namespace
 
   template <typename T>
   raw_ostream &operator<< (llvm::raw_ostream &os, const Printable<T> &printable) {
-    std::stringstream ss;
-    printable.print(ss, formats::PlainText());
-    os << ss.str();
+    formats::RawStreamBuf buf(os);
+    std::ostream out(&buf);
+    printable.print(out, formats::PlainText());
     return os;
   }
 } // end of cn namespace
@@ -0,0 +1,289 @@
+
+#ifndef MORPH_PNML_FMT
+#define MORPH_PNML_FMT
+
+#include "morpheus/ADT/FrozenNet.hpp"
+#include "morpheus/Formats/Formatter.hpp"
+
+#include <cstring>
+#include <iterator>
+
+using namespace std;
+
+namespace cn {
+  namespace formats {
+
+    // =========================================================================
+    // Pnml Formatter
+
+    // Pnml writes nets in PNML (ISO/IEC 15909-2) as high-level (coloured)
+    // nets. The types of places, initial markings, guards and arc expressions
+    // are kept as text annotations of the Morpheus expressions, so a tool
+    // reads the structure of the net even if it does not understand them.
+    //
+    // The interface places of an ACN and the embedded net share a single
+    // page, the interface places are marked by the `morpheus` tool-specific
+    // element. A node is identified by its ID (`n<ID>`) and an arc by its
+    // startpoint and its position among the outgoing edges (`a<ID>_<k>`).
+    //
+    // NOTE: PNML nets are bipartite, while control flow edges may connect
+    //       two places or two transitions. Such an edge is written as a pair
+    //       of arcs with a silent transition (place) in the middle. A silent
+    //       place has the type `Unit` of control flow tokens and the arc
+    //       expression is written on the first arc of the pair.
+    class Pnml final : public Formatter {
+
+    public:
+      ostream& format(ostream &os, const NetElement &net_elem) const {
+        return write_text_(os, net_elem.name);
+      }
+
+      ostream& format(ostream &os, const Edge &edge) const {
+        // the position of the edge among the outgoing edges of its startpoint
+        size_t k = 0;
+        for (const auto &e : edge.startpoint.leads_to) {
+          if (&*e == &edge) {
+            break;
+          }
+          ++k;
+        }
+        return format_arc_(os, edge.startpoint.get_id(), isa<Place>(edge.startpoint),
+                           edge.endpoint.get_id(), isa<Place>(edge.endpoint),
+                           k, edge.arc_expr);
+      }
+
+      ostream& format(ostream &os, const Place &place) const {
+        return format_place_(os, place.get_id(), place.name, place.type, place.init_expr, false);
+      }
+
+      ostream& format(ostream &os, const Transition &transition) const {
+        return format_transition_(os, transition.get_id(), transition.name, transition.guard);
+      }
+
+      ostream& format(ostream &os, const CommunicationNet &cn) const {
+        os << header_("CN" + to_string(cn.get_id()));
+        format_nodes_(os, cn, false);
+        format_edges_(os, cn);
+        os << FOOTER;
+        return os;
+      }
+
+      // NOTE: the net is printed the same as its snapshot
+      ostream& format(ostream &os, const AddressableCN &acn) const {
+        os << header_("ACN" + to_string(acn.get_id()));
+        format_nodes_(os, acn, true);
+        format_nodes_(os, acn.embedded_cn, false);
+        format_edges_(os, acn);
+        format_edges_(os, acn.embedded_cn);
+        os << FOOTER;
+        return os;
+      }
+
+      ostream& format(ostream &os, const FrozenNet &net) const {
+        for (const NetPart &part : layout(net)) {
+          format(os, net, part, part.begin, part.end);
+        }
+        return os;
+      }
+
+      vector<NetPart> layout(const FrozenNet &net) const {
+        NetPart::Index nodes_end = net.nodes_size();
+        return {
+          NetPart::of_text(header_("ACN" + to_string(net.get_id()))),
+          NetPart::of_nodes(0, nodes_end),
+          NetPart::of_edges(NetPart::EDGES, 0, nodes_end),
+          NetPart::of_text(FOOTER),
+        };
+      }
+
+      ostream& format(ostream &os, const FrozenNet &net, const NetPart &part,
+                      NetPart::Index begin, NetPart::Index end) const {
+        switch (part.kind) {
+          case NetPart::TEXT:
+            os << part.text;
+            break;
+
+          case NetPart::NODES:
+            for (NetPart::Index n = begin; n < end; ++n) {
+              if (n < net.places_end()) {
+                FrozenNet::PlaceRef p(net, n);
+                format_place_(os, p.get_id(), p.name(), p.type(), p.init_expr(),
+                              n < net.interface_end());
+              } else {
+                FrozenNet::TransitionRef t(net, n);
+                format_transition_(os, t.get_id(), t.name(), t.guard());
+              }
+            }
+            break;
+
+          case NetPart::EDGES:
+          case NetPart::REGULAR_EDGES:
+          case NetPart::CONTROL_FLOW_EDGES:
+            for (NetPart::Index n = begin; n < end; ++n) {
+              FrozenNet::NodeRef node(net, n);
+              auto edges = part.kind == NetPart::EDGES ? node.leads_to()
+                         : node.leads_to(part.kind == NetPart::REGULAR_EDGES ? REGULAR : CONTROL_FLOW);
+              // NOTE: the control flow edges follow the regular ones
+              size_t k = 0;
+              if (part.kind == NetPart::CONTROL_FLOW_EDGES) {
+                auto regular = node.leads_to(REGULAR);
+                k = std::distance(regular.begin(), regular.end());
+              }
+              for (const FrozenNet::EdgeRef &e : edges) {
+                format_arc_(os, e.startpoint().get_id(), e.startpoint().is_place(),
+                            e.endpoint().get_id(), e.endpoint().is_place(),
+                            k++, e.arc_expr());
+              }
+            }
+            break;
+        }
+        return os;
+      }
+
+    private:
+      using ID = Identifiable::ID;
+
+      static constexpr const char *FOOTER = "</page>\n</net>\n</pnml>\n";
+
+      static string header_(const string &id) {
+        return "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+               "<pnml xmlns=\"http://www.pnml.org/version-2009/grammar/pnml\">\n"
+               "<net id=\"" + id + "\" type=\"http://www.pnml.org/version-2009/grammar/highlevelnet\">\n"
+               "<name><text>" + id + "</text></name>\n"
+               "<page id=\"" + id + "-page\">\n";
+      }
+
+      // writes the symbol with the XML special characters escaped
+      ostream& write_text_(ostream &os, Symbol text) const {
+        StringRef str = text.ref();
+        size_t begin = 0;
+        for (size_t i = 0; i < str.size(); ++i) {
+          const char *escaped = nullptr;
+          switch (str[i]) {
+            case '<':  escaped = "&lt;";   break;
+            case '>':  escaped = "&gt;";   break;
+            case '&':  escaped = "&amp;";  break;
+            case '"':  escaped = "&quot;"; break;
+            case '\'': escaped = "&apos;"; break;
+            default: continue;
+          }
+          os.write(str.data() + begin, i - begin);
+          os.write(escaped, strlen(escaped));
+          begin = i + 1;
+        }
+        os.write(str.data() + begin, str.size() - begin);
+        return os;
+      }
+
+      ostream& format_name_(ostream &os, Symbol name) const {
+        if (!name.empty()) {
+          os << "<name><text>";
+          write_text_(os, name) << "</text></name>";
+        }
+        return os;
+      }
+
+      void format_nodes_(ostream &os, const CommunicationNet &cn, bool interface) const {
+        for (const auto &p : cn.places()) {
+          format_place_(os, p->get_id(), p->name, p->type, p->init_expr, interface);
+        }
+        for (const auto &t : cn.transitions()) {
+          format_transition_(os, t->get_id(), t->name, t->guard);
+        }
+      }
+
+      void format_edges_(ostream &os, const CommunicationNet &cn) const {
+        auto format_edges = [&](const NetElement &n) {
+          size_t k = 0;
+          for (const auto &e : n.leads_to) {
+            format_arc_(os, n.get_id(), isa<Place>(n), e->endpoint.get_id(),
+                        isa<Place>(e->endpoint), k++, e->arc_expr);
+          }
+        };
+        for (const auto &p : cn.places()) {
+          format_edges(*p);
+        }
+        for (const auto &t : cn.transitions()) {
+          format_edges(*t);
+        }
+      }
+
+      ostream& format_place_(ostream &os, ID id, Symbol name, Symbol type,
+                             Symbol init_expr, bool interface) const {
+        os << "<place id=\"n" << id << "\">";
+        format_name_(os, name);
+        if (!type.empty()) {
+          os << "<type><text>";
+          write_text_(os, type) << "</text></type>";
+        }
+        if (!init_expr.empty()) {
+          os << "<hlinitialMarking><text>";
+          write_text_(os, init_expr) << "</text></hlinitialMarking>";
+        }
+        if (interface) {
+          os << "<toolspecific tool=\"morpheus\" version=\"1.0\"><interface/></toolspecific>";
+        }
+        os << "</place>\n";
+        return os;
+      }
+
+      template <typename Guard>
+      ostream& format_transition_(ostream &os, ID id, Symbol name, const Guard &guard) const {
+        os << "<transition id=\"n" << id << "\">";
+        format_name_(os, name);
+        if (!guard.empty()) {
+          os << "<condition><text>";
+          bool first = true;
+          for (Symbol g : guard) {
+            if (!first) {
+              os << " &amp;&amp; ";
+            }
+            write_text_(os, g);
+            first = false;
+          }
+          os << "</text></condition>";
+        }
+        os << "</transition>\n";
+        return os;
+      }
+
+      ostream& format_inscription_(ostream &os, Symbol arc_expr) const {
+        if (!arc_expr.empty()) {
+          os << "<hlinscription><text>";
+          write_text_(os, arc_expr) << "</text></hlinscription>";
+        }
+        return os;
+      }
+
+      ostream& format_arc_(ostream &os, ID startpoint, bool from_place,
+                           ID endpoint, bool to_place, size_t k, Symbol arc_expr) const {
+        if (from_place != to_place) {
+          os << "<arc id=\"a" << startpoint << "_" << k << "\""
+             << " source=\"n" << startpoint << "\" target=\"n" << endpoint << "\">";
+          return format_inscription_(os, arc_expr) << "</arc>\n";
+        }
+
+        // the silent node `a<ID>_<k>` between two places (transitions),
+        // a silent place carries the control flow token
+        os << (from_place ? "<transition" : "<place")
+           << " id=\"a" << startpoint << "_" << k << "\">"
+           << (from_place ? "" : "<type><text>Unit</text></type>")
+           << "<toolspecific tool=\"morpheus\" version=\"1.0\"><silent/></toolspecific>"
+           << (from_place ? "</transition>\n" : "</place>\n");
+
+        // NOTE: the inscription is written only once, on the arc leaving
+        //       the startpoint
+        os << "<arc id=\"a" << startpoint << "_" << k << "-in\""
+           << " source=\"n" << startpoint << "\" target=\"a" << startpoint << "_" << k << "\">";
+        format_inscription_(os, arc_expr) << "</arc>\n";
+
+        os << "<arc id=\"a" << startpoint << "_" << k << "-out\""
+           << " source=\"a" << startpoint << "_" << k << "\" target=\"n" << endpoint << "\"></arc>\n";
+        return os;
+      }
+    };
+
+  } // end of formats namespace
+} // end of cn namespace
+
+# endif // MORPH_PNML_FMT
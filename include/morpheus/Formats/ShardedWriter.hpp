@@ -0,0 +1,142 @@
+
+#ifndef MORPH_SHARDED_WRITER_FMT
+#define MORPH_SHARDED_WRITER_FMT
+
+#include "morpheus/ADT/FrozenNet.hpp"
+#include "morpheus/Formats/Formatter.hpp"
+
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+using namespace std;
+
+namespace cn {
+  namespace formats {
+
+    // ShardedWriter prints a FrozenNet by several threads. The ranges of the
+    // formatter's layout are split into shards of `shard_size` nodes, the
+    // workers format the shards into buffers of their own and the buffers
+    // are written in the order of the layout. Hence the output is the same
+    // as of the formatter alone, regardless of the number of jobs.
+    //
+    // The formatter is called directly if its type is known, e.g. in
+    // `ShardedWriter(DotGraph(), jobs)`, while `ShardedWriter<>` formats by
+    // any formatter through the Formatter interface.
+    //
+    // NOTE: The workers are at most a few shards per job ahead of the output,
+    //       so the memory taken by the buffers does not grow with the net.
+    template <typename Fmt = Formatter>
+    class ShardedWriter final {
+
+    public:
+      using Index = NetPart::Index;
+
+      ShardedWriter(const Fmt &fmt, unsigned jobs, Index shard_size = 4096)
+        : fmt_(fmt), jobs_(max(jobs, 1u)), shard_size_(max(shard_size, Index(1))) { }
+
+      ostream& write(ostream &os, const FrozenNet &net) const {
+        vector<NetPart> parts = fmt_.layout(net);
+        vector<Shard> shards = split_(parts);
+
+        if (jobs_ == 1 || shards.size() == 1) {
+          for (const Shard &s : shards) {
+            fmt_.format(os, net, *s.part, s.begin, s.end);
+          }
+          return os;
+        }
+
+        vector<string> buffers(shards.size());
+        vector<bool> done(shards.size(), false);
+        size_t next = 0;    // the first shard not taken by a worker
+        size_t written = 0; // the first shard not written
+        size_t ahead = 4 * jobs_;
+        mutex m;
+        condition_variable shard_done, shard_written;
+
+        auto work = [&] {
+          while (true) {
+            size_t i;
+            {
+              unique_lock<mutex> lock(m);
+              shard_written.wait(lock, [&] {
+                return next == shards.size() || next < written + ahead;
+              });
+              if (next == shards.size()) {
+                return;
+              }
+              i = next++;
+            }
+
+            string buffer;
+            {
+              llvm::raw_string_ostream ros(buffer);
+              RawStreamBuf buf(ros);
+              ostream shard_os(&buf);
+              fmt_.format(shard_os, net, *shards[i].part, shards[i].begin, shards[i].end);
+            }
+
+            {
+              lock_guard<mutex> lock(m);
+              buffers[i] = move(buffer);
+              done[i] = true;
+            }
+            shard_done.notify_one();
+          }
+        };
+
+        vector<thread> workers;
+        for (unsigned j = 0; j < min(size_t(jobs_), shards.size()); ++j) {
+          workers.emplace_back(work);
+        }
+
+        for (size_t i = 0; i < shards.size(); ++i) {
+          string buffer;
+          {
+            unique_lock<mutex> lock(m);
+            shard_done.wait(lock, [&] { return done[i]; });
+            buffer = move(buffers[i]);
+            written = i + 1;
+          }
+          shard_written.notify_all();
+          os << buffer;
+        }
+
+        for (thread &w : workers) {
+          w.join();
+        }
+        return os;
+      }
+
+    private:
+      struct Shard {
+        const NetPart *part;
+        Index begin, end;
+      };
+
+      vector<Shard> split_(const vector<NetPart> &parts) const {
+        vector<Shard> shards;
+        for (const NetPart &part : parts) {
+          if (part.kind == NetPart::TEXT) {
+            shards.push_back({&part, 0, 0});
+            continue;
+          }
+          for (Index b = part.begin; b < part.end; b += min(shard_size_, part.end - b)) {
+            shards.push_back({&part, b, b + min(shard_size_, part.end - b)});
+          }
+        }
+        return shards;
+      }
+
+      const Fmt &fmt_;
+      unsigned jobs_;
+      Index shard_size_;
+    };
+
+  } // end of formats namespace
+} // end of cn namespace
+
+# endif // MORPH_SHARDED_WRITER_FMT
@@ -18,8 +18,9 @@ void store_if_not(std::vector<T> &values, const T &v, T excl) {
   }
 }
 
-template<typename T>
-std::string pp_vector(const std::vector<T> &values,
+// NOTE: any container with random access can be printed (e.g. ArrayRef)
+template<typename Container>
+std::string pp_vector(const Container &values,
                       std::string delim=",",
                       std::string lbracket="",
                       std::string rbracket="") {
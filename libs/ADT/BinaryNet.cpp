@@ -0,0 +1,538 @@
+#include "morpheus/ADT/BinaryNet.hpp"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/LEB128.h"
+
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace cn {
+
+  using namespace llvm;
+  using namespace llvm::support;
+
+  namespace {
+    constexpr size_t HEADER_SIZE = sizeof(binary::MAGIC) + 2 * sizeof(uint32_t);
+    constexpr size_t SECTION_ENTRY_SIZE = 2 * sizeof(uint32_t) + 2 * sizeof(uint64_t);
+    constexpr uint32_t SECTIONS_SIZE = 5;
+
+    uint64_t zigzag(int64_t value) {
+      return (uint64_t(value) << 1) ^ uint64_t(value >> 63);
+    }
+
+    int64_t unzigzag(uint64_t value) {
+      return int64_t(value >> 1) ^ -int64_t(value & 1);
+    }
+
+    template <typename T>
+    void write_fixed(raw_ostream &os, T value) {
+      char buffer[sizeof(T)];
+      endian::write<T, little, unaligned>(buffer, value);
+      os.write(buffer, sizeof(T));
+    }
+
+    template <typename T>
+    T read_fixed(const uint8_t *pos) {
+      return endian::read<T, little, unaligned>(pos);
+    }
+
+    Error malformed(const Twine &msg) {
+      return make_error<StringError>("malformed binary net: " + msg, inconvertibleErrorCode());
+    }
+  }
+
+  // ---------------------------------------------------------------------------
+  // BinaryNetWriter
+
+  class BinaryNetWriter {
+
+    using Index = FrozenNet::Index;
+
+  public:
+    explicit BinaryNetWriter(const FrozenNet &net) : net_(net) { }
+
+    void write(raw_ostream &os) {
+      // NOTE: the strings are numbered while the other sections are encoded
+      strings_.push_back(StringRef());
+      std::string meta = encode_meta_();
+      std::string nodes = encode_nodes_();
+      std::string edges = encode_edges_();
+      std::string incoming = encode_incoming_();
+      std::string strings = encode_strings_();
+
+      std::pair<binary::Section, const std::string *> sections[SECTIONS_SIZE] = {
+        {binary::Section::META, &meta},
+        {binary::Section::STRINGS, &strings},
+        {binary::Section::NODES, &nodes},
+        {binary::Section::EDGES, &edges},
+        {binary::Section::INCOMING, &incoming},
+      };
+
+      os.write(binary::MAGIC, sizeof(binary::MAGIC));
+      write_fixed<uint32_t>(os, binary::VERSION);
+      write_fixed<uint32_t>(os, SECTIONS_SIZE);
+
+      uint64_t offset = HEADER_SIZE + SECTIONS_SIZE * SECTION_ENTRY_SIZE;
+      for (const auto &section : sections) {
+        write_fixed<uint32_t>(os, uint32_t(section.first));
+        write_fixed<uint32_t>(os, 0);
+        write_fixed<uint64_t>(os, offset);
+        write_fixed<uint64_t>(os, section.second->size());
+        offset += section.second->size();
+      }
+      for (const auto &section : sections) {
+        os << *section.second;
+      }
+    }
+
+  private:
+    uint64_t string_(Symbol sym) {
+      if (sym.empty()) {
+        return 0;
+      }
+      auto inserted = string_indices_.insert({sym.ref(), strings_.size()});
+      if (inserted.second) {
+        strings_.push_back(sym.ref());
+      }
+      return inserted.first->second;
+    }
+
+    std::string encode_meta_() {
+      auto special = [](Index index) {
+        return index == FrozenNet::NO_NODE ? 0 : uint64_t(index) + 1;
+      };
+
+      std::string buffer;
+      raw_string_ostream os(buffer);
+      for (uint64_t value : {uint64_t(net_.id_), uint64_t(net_.embedded_id_), uint64_t(net_.address_),
+                             uint64_t(net_.interface_end_), uint64_t(net_.places_end_),
+                             uint64_t(net_.nodes_size()), uint64_t(net_.edges_size()),
+                             uint64_t(net_.asr_), uint64_t(net_.arr_),
+                             uint64_t(net_.csr_), uint64_t(net_.crr_),
+                             special(net_.entry_), special(net_.exit_)}) {
+        encodeULEB128(value, os);
+      }
+      return os.str();
+    }
+
+    std::string encode_strings_() {
+      std::string buffer;
+      raw_string_ostream os(buffer);
+      write_fixed<uint32_t>(os, strings_.size());
+      uint32_t offset = 0;
+      write_fixed<uint32_t>(os, offset);
+      for (StringRef str : strings_) {
+        offset += str.size();
+        write_fixed<uint32_t>(os, offset);
+      }
+      for (StringRef str : strings_) {
+        os << str;
+      }
+      return os.str();
+    }
+
+    std::string encode_nodes_() {
+      std::string buffer;
+      raw_string_ostream os(buffer);
+      for (Index n = 0; n < net_.places_end_; n++) {
+        encodeULEB128(net_.ids_[n], os);
+        encodeULEB128(string_(net_.names_[n]), os);
+        encodeULEB128(string_(net_.types_[n]), os);
+        encodeULEB128(string_(net_.init_exprs_[n]), os);
+      }
+      for (const FrozenNet::TransitionRef &t : net_.transitions()) {
+        encodeULEB128(t.get_id(), os);
+        encodeULEB128(string_(t.name()), os);
+        ArrayRef<Symbol> guard = t.guard();
+        encodeULEB128(guard.size(), os);
+        for (Symbol cond : guard) {
+          encodeULEB128(string_(cond), os);
+        }
+      }
+      return os.str();
+    }
+
+    std::string encode_edges_() {
+      std::string buffer;
+      raw_string_ostream os(buffer);
+      for (Index n = 0; n < net_.nodes_size(); n++) {
+        for (unsigned c = 0; c < 2; c++) {
+          Index begin = net_.out_offsets_[2 * n + c];
+          Index end = net_.out_offsets_[2 * n + c + 1];
+          encodeULEB128(end - begin, os);
+          for (Index e = begin; e < end; e++) {
+            encodeULEB128(zigzag(int64_t(net_.endpoints_[e]) - n), os);
+            encodeULEB128(string_(net_.arc_exprs_[e]), os);
+            encodeULEB128(net_.types_of_edges_[e], os);
+          }
+        }
+      }
+      return os.str();
+    }
+
+    std::string encode_incoming_() {
+      std::string buffer;
+      raw_string_ostream os(buffer);
+      for (Index n = 0; n < net_.nodes_size(); n++) {
+        Index begin = net_.in_offsets_[n];
+        Index end = net_.in_offsets_[n + 1];
+        encodeULEB128(end - begin, os);
+        int64_t previous = 0;
+        for (Index i = begin; i < end; i++) {
+          encodeULEB128(zigzag(int64_t(net_.in_edges_[i]) - previous), os);
+          previous = net_.in_edges_[i];
+        }
+      }
+      return os.str();
+    }
+
+    const FrozenNet &net_;
+    std::vector<StringRef> strings_;
+    DenseMap<StringRef, uint64_t> string_indices_;
+  };
+
+  // ---------------------------------------------------------------------------
+  // BinaryNetReader
+
+  class BinaryNetReader {
+
+    using Index = FrozenNet::Index;
+
+    // Cursor decodes the numbers of a section, once it runs out of the
+    // section it keeps returning zeros and the error is reported at the end.
+    struct Cursor {
+      const uint8_t *pos;
+      const uint8_t *end;
+      const char *error = nullptr;
+
+      uint64_t next() {
+        if (error) {
+          return 0;
+        }
+        unsigned size = 0;
+        uint64_t value = decodeULEB128(pos, &size, end, &error);
+        pos += size;
+        return value;
+      }
+
+      // reads a number into a narrower field, a number out of its range is
+      // an error (it would wrap around and pass the checks of the field)
+      template <typename T>
+      void next_into(T &field) {
+        uint64_t value = next();
+        if (value > std::numeric_limits<T>::max() && !error) {
+          error = "number out of range";
+        }
+        field = T(value);
+      }
+    };
+
+  public:
+    explicit BinaryNetReader(MemoryBufferRef buffer)
+      : data_(reinterpret_cast<const uint8_t *>(buffer.getBufferStart())),
+        size_(buffer.getBufferSize()) { }
+
+    Expected<FrozenNet> read() {
+      if (Error err = read_header_()) {
+        return std::move(err);
+      }
+
+      FrozenNet net;
+      if (Error err = read_strings_()) {
+        return std::move(err);
+      }
+      if (Error err = read_meta_(net)) {
+        return std::move(err);
+      }
+      if (Error err = read_nodes_(net)) {
+        return std::move(err);
+      }
+      if (Error err = read_edges_(net)) {
+        return std::move(err);
+      }
+      if (Error err = read_incoming_(net)) {
+        return std::move(err);
+      }
+      net.symbols_ = symbols_;
+      return std::move(net);
+    }
+
+  private:
+    Error read_header_() {
+      if (size_ < HEADER_SIZE || memcmp(data_, binary::MAGIC, sizeof(binary::MAGIC)) != 0) {
+        return malformed("missing header");
+      }
+      const uint8_t *pos = data_ + sizeof(binary::MAGIC);
+      uint32_t version = read_fixed<uint32_t>(pos);
+      if (version != binary::VERSION) {
+        return malformed("unsupported version " + Twine(version));
+      }
+      uint32_t count = read_fixed<uint32_t>(pos + sizeof(uint32_t));
+      if (count > (size_ - HEADER_SIZE) / SECTION_ENTRY_SIZE) {
+        return malformed("truncated section table");
+      }
+
+      for (uint32_t i = 0; i < count; i++) {
+        const uint8_t *entry = data_ + HEADER_SIZE + i * SECTION_ENTRY_SIZE;
+        uint32_t kind = read_fixed<uint32_t>(entry);
+        uint64_t offset = read_fixed<uint64_t>(entry + 2 * sizeof(uint32_t));
+        uint64_t size = read_fixed<uint64_t>(entry + 2 * sizeof(uint32_t) + sizeof(uint64_t));
+        if (offset > size_ || size > size_ - offset) {
+          return malformed("section out of the file");
+        }
+        // NOTE: unknown sections are skipped
+        if (kind >= 1 && kind <= SECTIONS_SIZE) {
+          sections_[kind - 1] = {data_ + offset, data_ + offset + size};
+        }
+      }
+      for (const Cursor &section : sections_) {
+        if (!section.pos) {
+          return malformed("missing section");
+        }
+      }
+      return Error::success();
+    }
+
+    Cursor &section_(binary::Section kind) {
+      return sections_[uint32_t(kind) - 1];
+    }
+
+    uint64_t section_size_(binary::Section kind) {
+      const Cursor &c = section_(kind);
+      return c.end - c.pos;
+    }
+
+    Error read_strings_() {
+      Cursor &c = section_(binary::Section::STRINGS);
+      size_t size = c.end - c.pos;
+      // the count and at least the first offset
+      if (size < 2 * sizeof(uint32_t)) {
+        return malformed("truncated strings");
+      }
+      uint32_t count = read_fixed<uint32_t>(c.pos);
+      if (count == 0 || uint64_t(count) + 1 > (size - sizeof(uint32_t)) / sizeof(uint32_t)) {
+        return malformed("truncated strings");
+      }
+
+      const uint8_t *offsets = c.pos + sizeof(uint32_t);
+      const char *bytes = reinterpret_cast<const char *>(offsets + (count + 1) * sizeof(uint32_t));
+      size_t bytes_size = c.end - reinterpret_cast<const uint8_t *>(bytes);
+
+      symbols_ = std::make_shared<SymbolTable>();
+      strings_.reserve(count);
+      uint32_t begin = read_fixed<uint32_t>(offsets);
+      for (uint32_t i = 0; i < count; i++) {
+        uint32_t end = read_fixed<uint32_t>(offsets + (i + 1) * sizeof(uint32_t));
+        if (begin > end || end > bytes_size) {
+          return malformed("string out of the table");
+        }
+        strings_.push_back(symbols_->intern(StringRef(bytes + begin, end - begin)));
+        begin = end;
+      }
+      return Error::success();
+    }
+
+    Symbol symbol_(Cursor &c) {
+      uint64_t index = c.next();
+      if (index >= strings_.size()) {
+        c.error = "unknown string";
+        return Symbol();
+      }
+      return strings_[index];
+    }
+
+    Error read_meta_(FrozenNet &net) {
+      Cursor &c = section_(binary::Section::META);
+      c.next_into(net.id_);
+      c.next_into(net.embedded_id_);
+      c.next_into(net.address_);
+      c.next_into(net.interface_end_);
+      c.next_into(net.places_end_);
+      nodes_ = c.next();
+      edges_ = c.next();
+      c.next_into(net.asr_);
+      c.next_into(net.arr_);
+      c.next_into(net.csr_);
+      c.next_into(net.crr_);
+      auto special = [&c] {
+        uint64_t value = c.next();
+        if (value > FrozenNet::NO_NODE && !c.error) {
+          c.error = "number out of range";
+        }
+        return value == 0 ? FrozenNet::NO_NODE : Index(value - 1);
+      };
+      net.entry_ = special();
+      net.exit_ = special();
+      if (c.error) {
+        return malformed(c.error);
+      }
+
+      if (net.interface_end_ > net.places_end_ || net.places_end_ > nodes_ ||
+          nodes_ >= FrozenNet::NO_NODE || edges_ >= FrozenNet::NO_NODE) {
+        return malformed("inconsistent sizes");
+      }
+      // NOTE: each node and edge takes at least a byte per number in its
+      //       sections, so the sizes are bounded by the file before anything
+      //       is allocated for them
+      uint64_t places = net.places_end_, transitions = nodes_ - places;
+      if (4 * places + 3 * transitions > section_size_(binary::Section::NODES) ||
+          2 * nodes_ + 3 * edges_ > section_size_(binary::Section::EDGES) ||
+          nodes_ + edges_ > section_size_(binary::Section::INCOMING)) {
+        return malformed("sizes out of the sections");
+      }
+      for (Index special : {net.asr_, net.arr_, net.csr_, net.crr_}) {
+        if (special >= net.interface_end_) {
+          return malformed("the special place is not an interface place");
+        }
+      }
+      for (Index special : {net.entry_, net.exit_}) {
+        if (special != FrozenNet::NO_NODE && special >= net.places_end_) {
+          return malformed("the entry or exit is not a place");
+        }
+      }
+      return Error::success();
+    }
+
+    Error read_nodes_(FrozenNet &net) {
+      Cursor &c = section_(binary::Section::NODES);
+      net.ids_.reserve(nodes_);
+      net.names_.reserve(nodes_);
+      net.types_.reserve(net.places_end_);
+      net.init_exprs_.reserve(net.places_end_);
+      for (Index n = 0; n < net.places_end_ && !c.error; n++) {
+        Identifiable::ID id;
+        c.next_into(id);
+        net.ids_.push_back(id);
+        net.names_.push_back(symbol_(c));
+        net.types_.push_back(symbol_(c));
+        net.init_exprs_.push_back(symbol_(c));
+      }
+
+      net.guard_offsets_.reserve(nodes_ - net.places_end_ + 1);
+      net.guard_offsets_.push_back(0);
+      for (Index n = net.places_end_; n < nodes_ && !c.error; n++) {
+        Identifiable::ID id;
+        c.next_into(id);
+        net.ids_.push_back(id);
+        net.names_.push_back(symbol_(c));
+        uint64_t guard = c.next();
+        for (uint64_t i = 0; i < guard && !c.error; i++) {
+          net.guards_.push_back(symbol_(c));
+        }
+        net.guard_offsets_.push_back(net.guards_.size());
+      }
+      if (c.error) {
+        return malformed(c.error);
+      }
+      return Error::success();
+    }
+
+    Error read_edges_(FrozenNet &net) {
+      Cursor &c = section_(binary::Section::EDGES);
+      net.out_offsets_.reserve(2 * nodes_ + 1);
+      net.out_offsets_.push_back(0);
+      net.startpoints_.reserve(edges_);
+      net.endpoints_.reserve(edges_);
+      net.arc_exprs_.reserve(edges_);
+      net.categories_.reserve(edges_);
+      net.types_of_edges_.reserve(edges_);
+
+      for (Index n = 0; n < nodes_ && !c.error; n++) {
+        for (EdgeCategory category : {REGULAR, CONTROL_FLOW}) {
+          uint64_t count = c.next();
+          if (count > edges_ - net.endpoints_.size()) {
+            return malformed("too many edges");
+          }
+          for (uint64_t i = 0; i < count && !c.error; i++) {
+            int64_t endpoint = int64_t(n) + unzigzag(c.next());
+            Symbol arc_expr = symbol_(c);
+            uint64_t type = c.next();
+            if (endpoint < 0 || uint64_t(endpoint) >= nodes_ || type > SHUFFLE_RO) {
+              return malformed("invalid edge");
+            }
+            net.startpoints_.push_back(n);
+            net.endpoints_.push_back(endpoint);
+            net.arc_exprs_.push_back(arc_expr);
+            net.categories_.push_back(category);
+            net.types_of_edges_.push_back(EdgeType(type));
+          }
+          net.out_offsets_.push_back(net.endpoints_.size());
+        }
+      }
+      if (c.error) {
+        return malformed(c.error);
+      }
+      if (net.endpoints_.size() != edges_) {
+        return malformed("missing edges");
+      }
+      return Error::success();
+    }
+
+    Error read_incoming_(FrozenNet &net) {
+      Cursor &c = section_(binary::Section::INCOMING);
+      net.in_offsets_.reserve(nodes_ + 1);
+      net.in_offsets_.push_back(0);
+      net.in_edges_.reserve(edges_);
+
+      // each edge is referenced exactly once, by its endpoint
+      std::vector<bool> referenced(edges_, false);
+      for (Index n = 0; n < nodes_ && !c.error; n++) {
+        uint64_t count = c.next();
+        if (count > edges_ - net.in_edges_.size()) {
+          return malformed("too many incoming edges");
+        }
+        int64_t edge = 0;
+        for (uint64_t i = 0; i < count && !c.error; i++) {
+          edge += unzigzag(c.next());
+          if (edge < 0 || uint64_t(edge) >= edges_ || net.endpoints_[edge] != n ||
+              referenced[edge]) {
+            return malformed("invalid incoming edge");
+          }
+          referenced[edge] = true;
+          net.in_edges_.push_back(edge);
+        }
+        net.in_offsets_.push_back(net.in_edges_.size());
+      }
+      if (c.error) {
+        return malformed(c.error);
+      }
+      if (net.in_edges_.size() != edges_) {
+        return malformed("missing incoming edges");
+      }
+      return Error::success();
+    }
+
+    const uint8_t *data_;
+    size_t size_;
+    Cursor sections_[SECTIONS_SIZE] = {};
+
+    uint64_t nodes_ = 0;
+    uint64_t edges_ = 0;
+    std::shared_ptr<SymbolTable> symbols_;
+    std::vector<Symbol> strings_;
+  };
+
+  // ---------------------------------------------------------------------------
+  // public API
+
+  void write_binary(raw_ostream &os, const FrozenNet &net) {
+    BinaryNetWriter(net).write(os);
+  }
+
+  Expected<FrozenNet> read_binary(MemoryBufferRef buffer) {
+    return BinaryNetReader(buffer).read();
+  }
+
+  Expected<FrozenNet> read_binary_file(StringRef path) {
+    ErrorOr<std::unique_ptr<MemoryBuffer>> buffer = MemoryBuffer::getFile(path);
+    if (!buffer) {
+      return errorCodeToError(buffer.getError());
+    }
+    return read_binary((*buffer)->getMemBufferRef());
+  }
+
+} // end of communication net (cn) namespace
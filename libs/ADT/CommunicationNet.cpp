@@ -2,16 +2,61 @@
 #include "morpheus/ADT/CommunicationNet.hpp"
 #include "morpheus/Formats/PlainText.hpp"
 
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+
 #include <algorithm>
+#include <map>
 #include <sstream>
+#include <tuple>
+#include <vector>
 
 namespace cn {
 
   using namespace llvm;
 
+  namespace {
+    Identifiable::IDAllocator process_id_allocator;
+    thread_local Identifiable::IDAllocator *thread_id_allocator = nullptr;
+    thread_local std::shared_ptr<SymbolTable> thread_symbol_table;
+  }
+
+  Identifiable::IDAllocator::Scope::Scope(IDAllocator &allocator)
+    : previous_(thread_id_allocator) {
+    thread_id_allocator = &allocator;
+  }
+
+  Identifiable::IDAllocator::Scope::~Scope() {
+    thread_id_allocator = previous_;
+  }
+
+  Identifiable::IDAllocator &Identifiable::IDAllocator::current() {
+    if (thread_id_allocator) {
+      return *thread_id_allocator;
+    }
+    return process_id_allocator;
+  }
+
   Identifiable::ID Identifiable::generate_id() {
-    static unsigned int id = 0;
-    return std::to_string(++id);
+    return IDAllocator::current().next();
+  }
+
+  SymbolTable::Scope::Scope(std::shared_ptr<SymbolTable> table)
+    : previous_(std::move(thread_symbol_table)) {
+    thread_symbol_table = std::move(table);
+  }
+
+  SymbolTable::Scope::~Scope() {
+    thread_symbol_table = std::move(previous_);
+  }
+
+  std::shared_ptr<SymbolTable> SymbolTable::current() {
+    if (thread_symbol_table) {
+      return thread_symbol_table;
+    }
+    // NOTE: the table is not synchronized, hence the default one is per thread
+    thread_local std::shared_ptr<SymbolTable> default_table = std::make_shared<SymbolTable>();
+    return default_table;
   }
 
   // ---------------------------------------------------------------------------
@@ -19,67 +64,402 @@ namespace cn {
 
   // # protected
   bool CommunicationNet::remove(NetElement &elem) {
-    if (elem.get_element_type() == "place_t") {
-      return remove(static_cast<Place &>(elem));
-    } else if (elem.get_element_type() == "transition_t") {
-      return remove(static_cast<Transition &>(elem));
-    } else {
-      assert(false && "Unknown type of the net element.");
+    switch (elem.get_kind()) {
+      case NetElement::Kind::PLACE:
+        return remove(cast<Place>(elem));
+      case NetElement::Kind::TRANSITION:
+        return remove(cast<Transition>(elem));
     }
+    assert(false && "Unknown kind of the net element.");
     return false;
   }
 
   // + public methods
   void CommunicationNet::resolve_unresolved() {
-    std::vector<UnresolvedPlace *> to_remove;
+    // NOTE: The places and transitions of the same request are matched one
+    //       to one in the order they were added. A collective place (i.e.
+    //       an array of requests) is matched with all the waits of the array.
+    struct RequestWaits {
+      std::vector<UnresolvedTransition *> transitions;
+      size_t next = 0;
+    };
+
+    DenseMap<const Value *, RequestWaits> waits;
+    for (const Element<UnresolvedTransition> &ut : unresolved_transitions_) {
+      waits[&ut->mpi_rqst].transitions.push_back(ut.get());
+    }
+
+    DenseSet<const UnresolvedPlace *> resolved_places;
+    DenseSet<const UnresolvedTransition *> resolved_transitions;
+
+    auto resolve = [&](UnresolvedPlace &up, UnresolvedTransition &ut) {
+      if (resolved_transitions.insert(&ut).second) {
+        up.resolve(*this, up.place, ut.transition, ut.unresolved_connect);
+      } else {
+        // the transition is already connected to the addressable CN
+        UnresolvedConnect resolved_connect;
+        up.resolve(*this, up.place, ut.transition, resolved_connect);
+      }
+      resolved_places.insert(&up);
+    };
 
     // match unresolved places with unresolved transitions
-    for (auto up_it = unresolved_places_.begin();
-         up_it != unresolved_places_.end();
-         up_it++) {
+    for (const Element<UnresolvedPlace> &up : unresolved_places_) {
+      auto waits_it = waits.find(&up->mpi_rqst);
+      if (waits_it == waits.end()) {
+        continue;
+      }
 
-      auto &up = *up_it;
-      auto matched_ut_it = std::find_if(
-        unresolved_transitions_.begin(), unresolved_transitions_.end(),
-        [&up](const auto &ut) { return &up->mpi_rqst == &ut->mpi_rqst; });
-      if (matched_ut_it != unresolved_transitions_.end()) {
-        auto &ut = *matched_ut_it;
-        up->resolve(*this, up->place, ut->transition, ut->unresolved_connect);
-        unresolved_transitions_.erase(matched_ut_it);
-        to_remove.push_back(up.get());
+      RequestWaits &rw = waits_it->second;
+      if (up->collective) {
+        for (UnresolvedTransition *ut : rw.transitions) {
+          resolve(*up, *ut);
+        }
+      } else {
+        // skip the waits already taken by collective places
+        while (rw.next < rw.transitions.size() &&
+               resolved_transitions.count(rw.transitions[rw.next])) {
+          rw.next++;
+        }
+        if (rw.next < rw.transitions.size()) {
+          resolve(*up, *rw.transitions[rw.next++]);
+        }
       }
     }
 
-    // remove resolved places
-    auto remove_from_it = unresolved_places_.end();
-    while (!to_remove.empty()) {
-      UnresolvedPlace *up_rm = to_remove.back();
-      to_remove.pop_back();
-      remove_from_it = std::remove_if(unresolved_places_.begin(), remove_from_it,
-                                      [up_rm](const auto &up) { return up.get() == up_rm; });
+    // remove resolved elements
+    for (const Element<UnresolvedPlace> &up : unresolved_places_) {
+      if (resolved_places.count(up.get())) {
+        unresolved_places_.take(up->handle);
+      }
+    }
+    for (const Element<UnresolvedTransition> &ut : unresolved_transitions_) {
+      if (resolved_transitions.count(ut.get())) {
+        unresolved_transitions_.take(ut->handle);
+      }
     }
-    unresolved_places_.erase(remove_from_it, unresolved_places_.end());
   }
 
-  void CommunicationNet::collapse() {
-    CommunicationNet tmp_cn;
-    collapse_topdown(places_, tmp_cn, &CommunicationNet::places_);
-    collapse_topdown(transitions_, tmp_cn, &CommunicationNet::transitions_);
-    std::swap(tmp_cn, *this);
+  // # protected
+  size_t CommunicationNet::collapse_chains() {
+    // NOTE: The collapse runs in place. The first top-down and bottom-up
+    //       rounds check all the elements in the order of storage. Afterwards,
+    //       only the neighbours of collapsed elements are checked again until
+    //       the fixpoint of repeated top-down and bottom-up passes is reached.
+    size_t size = places_.size() + transitions_.size();
 
-    tmp_cn.clear();
-    collapse_bottomup(places_, tmp_cn, &CommunicationNet::places_);
-    collapse_bottomup(transitions_, tmp_cn, &CommunicationNet::transitions_);
-    std::swap(tmp_cn, *this);
+    worklist_t topdown = element_refs<worklist_t>();
+    worklist_t bottomup;
+    collapse_topdown(topdown, bottomup);
 
+    bottomup = element_refs<worklist_t>();
+    while (!bottomup.empty()) {
+      collapse_bottomup(bottomup, topdown);
+      collapse_topdown(topdown, bottomup);
+    }
+
+    return size - (places_.size() + transitions_.size());
+  }
+
+  namespace {
+    bool is_unit_edge(const Edge &e) {
+      return e.get_category() == CONTROL_FLOW;
+    }
+
+    // checks whether the token consumed by `in` is produced unchanged by `out`
+    bool passes_unchanged(const Edge &in, const Edge &out) {
+      if (is_unit_edge(in) || is_unit_edge(out)) {
+        return is_unit_edge(in) && is_unit_edge(out);
+      }
+      return in.get_type() == SINGLE_HEADED && in.arc_expr == out.arc_expr;
+    }
+  }
+
+  size_t CommunicationNet::fuse_series(const pinned_t &pinned) {
+    // NOTE: A unit place `p` that is the only output of `t1` to the transition `t2`
+    //       and the only input of `t2` just orders both the transitions, i.e.
+    //       `t2` fires whenever `t1` has fired. The place and `t2` are fused
+    //       into `t1`, which takes over the outgoing edges of `t2`.
+    size_t fused = 0;
+    for (const ElementRef &ref : element_refs<vector<ElementRef>>()) {
+      Place *p = dyn_cast_or_null<Place>(lookup(ref));
+      if (!p || !is_removable(*p, pinned) || !p->init_expr.empty() ||
+          p->referenced_by.size() != 1 || p->leads_to.size() != 1) {
+        continue;
+      }
+
+      const Edge &in = *p->referenced_by.back();
+      const Edge &out = **p->leads_to.begin();
+      if (!is_unit_edge(in) || !is_unit_edge(out)) {
+        continue;
+      }
+
+      Transition *t1 = dyn_cast<Transition>(&in.startpoint);
+      Transition *t2 = dyn_cast<Transition>(&out.endpoint);
+      if (!t1 || !t2 || t1 == t2 || !owns(*t1) || !is_removable(*t2, pinned) ||
+          !t2->guard.empty() || t2->referenced_by.size() != 1) {
+        continue;
+      }
+
+      copy_outgoing(*t2, *t1);
+      erase(*t2);
+      erase(*p);
+      fused++;
+    }
+    return fused;
+  }
+
+  size_t CommunicationNet::remove_self_loops(const pinned_t &pinned) {
+    // NOTE: A control flow edge of a place to itself fuses the place with
+    //       itself. A transition consuming a token from a place and returning
+    //       it unchanged does not change any marking. Control flow self-loops
+    //       of transitions are kept, they repeat the transition.
+    size_t removed = 0;
+    for (const ElementRef &ref : element_refs<vector<ElementRef>>()) {
+      NetElement *elem = lookup(ref);
+      if (!elem || !owns(*elem)) {
+        continue;
+      }
+
+      if (Place *p = dyn_cast<Place>(elem)) {
+        Elements<Edge> &cf_edges = p->leads_to.of(CONTROL_FLOW);
+        for (size_t i = cf_edges.size(); i-- > 0; ) {
+          if (&cf_edges[i]->endpoint == p) {
+            remove_edge(*cf_edges[i]);
+            removed++;
+          }
+        }
+        continue;
+      }
+
+      Transition &t = cast<Transition>(*elem);
+      if (!is_removable(t, pinned) || !t.guard.empty() ||
+          t.referenced_by.size() != 1 || t.leads_to.size() != 1) {
+        continue;
+      }
+
+      const Edge &in = *t.referenced_by.back();
+      const Edge &out = **t.leads_to.begin();
+      if (isa<Place>(in.startpoint) && &in.startpoint == &out.endpoint &&
+          passes_unchanged(in, out)) {
+        erase(t);
+        removed++;
+      }
+    }
+    return removed;
+  }
+
+  size_t CommunicationNet::remove_identity_transitions(const pinned_t &pinned) {
+    // NOTE: A transition moving a token unchanged from `p1` to `p2` of the same type,
+    //       where it is the only output of `p1`, makes `p1` an alias of `p2`.
+    //       The transition is removed and `p1` is merged into `p2`.
+    size_t removed = 0;
+    for (const Element<Transition> &t : transitions_) {
+      if (!is_removable(*t, pinned) || !t->guard.empty() ||
+          t->referenced_by.size() != 1 || t->leads_to.size() != 1) {
+        continue;
+      }
+
+      const Edge &in = *t->referenced_by.back();
+      const Edge &out = **t->leads_to.begin();
+      Place *p1 = dyn_cast<Place>(&in.startpoint);
+      Place *p2 = dyn_cast<Place>(&out.endpoint);
+      if (!p1 || !p2 || p1 == p2 || !is_removable(*p1, pinned) ||
+          !p1->init_expr.empty() || p1->leads_to.size() != 1 ||
+          p1->type != p2->type || !passes_unchanged(in, out)) {
+        continue;
+      }
+
+      erase(*t);
+      redirect_incoming(*p1, *p2);
+      release(*p1);
+      removed++;
+    }
+    return removed;
+  }
+
+  size_t CommunicationNet::remove_dead_places(const pinned_t &pinned) {
+    // NOTE: A place without incoming edges and initial marking never gets
+    //       a token, hence the transitions it leads to never fire, nor do the
+    //       transitions following them by control flow. The place is removed
+    //       only if all these transitions can be removed. The places they lead
+    //       to are checked again, as they may lose their last incoming edge.
+    size_t removed = 0;
+
+    worklist_t worklist;
+    for (const Element<Place> &p : places_) {
+      worklist.push_back(ref_of(*p));
+    }
+
+    while (!worklist.empty()) {
+      Place *p = cast_or_null<Place>(lookup(worklist.front()));
+      worklist.pop_front();
+
+      if (!p || !is_removable(*p, pinned) || !p->init_expr.empty() ||
+          !p->referenced_by.empty()) {
+        continue;
+      }
+
+      // the transitions that never fire
+      vector<NetElement *> dead{p};
+      DenseSet<const NetElement *> visited{p};
+      bool removable = true;
+      for (size_t i = 0; i < dead.size() && removable; i++) {
+        for (const Element<Edge> &e : dead[i]->leads_to) {
+          NetElement &endpoint = e->endpoint;
+          if (isa<Transition>(endpoint) && visited.insert(&endpoint).second) {
+            removable = is_removable(endpoint, pinned);
+            dead.push_back(&endpoint);
+          }
+        }
+      }
+      if (!removable) {
+        continue;
+      }
+
+      for (const NetElement *elem : dead) {
+        for (const Element<Edge> &e : elem->leads_to) {
+          if (isa<Place>(e->endpoint) && !visited.count(&e->endpoint)) {
+            enqueue(worklist, e->endpoint);
+          }
+        }
+      }
+      for (NetElement *elem : dead) {
+        erase(*elem);
+      }
+      removed++;
+    }
+    return removed;
+  }
+
+  namespace {
+    // EdgeKey describes an edge of a place by its other end
+    struct EdgeKey {
+      const NetElement *elem;
+      StringRef arc_expr;
+      EdgeCategory category;
+      EdgeType type;
+
+      bool operator<(const EdgeKey &k) const {
+        return std::tie(elem, arc_expr, category, type)
+             < std::tie(k.elem, k.arc_expr, k.category, k.type);
+      }
+    };
+
+    // PlaceKey is equal for the places that are marked the same in every
+    // reachable marking, i.e. having the same type, initial marking and edges
+    struct PlaceKey {
+      StringRef type;
+      StringRef init_expr;
+      std::vector<EdgeKey> in;
+      std::vector<EdgeKey> out;
+
+      explicit PlaceKey(const Place &p)
+        : type(p.type.ref()), init_expr(p.init_expr.ref()) {
+        for (const Edge *e : p.referenced_by) {
+          in.push_back({&e->startpoint, e->arc_expr.ref(), e->get_category(), e->get_type()});
+        }
+        for (const Element<Edge> &e : p.leads_to) {
+          out.push_back({&e->endpoint, e->arc_expr.ref(), e->get_category(), e->get_type()});
+        }
+        std::sort(in.begin(), in.end());
+        std::sort(out.begin(), out.end());
+      }
+
+      bool operator<(const PlaceKey &k) const {
+        return std::tie(type, init_expr, in, out) < std::tie(k.type, k.init_expr, k.in, k.out);
+      }
+    };
+  }
+
+  size_t CommunicationNet::merge_equivalent_places(const pinned_t &pinned) {
+    // NOTE: The edges of a removed place change the keys of its neighbours,
+    //       such places are merged by the next round of the reduction.
+    size_t merged = 0;
+    std::map<PlaceKey, Place *> classes;
+    for (const ElementRef &ref : element_refs<vector<ElementRef>>()) {
+      Place *p = dyn_cast_or_null<Place>(lookup(ref));
+      if (!p) {
+        continue;
+      }
+
+      auto inserted = classes.insert({PlaceKey(*p), p});
+      if (inserted.second) {
+        continue;
+      }
+
+      // the removable place of both is dropped
+      Place *&kept = inserted.first->second;
+      if (!is_removable(*p, pinned)) {
+        if (!is_removable(*kept, pinned)) {
+          continue;
+        }
+        std::swap(kept, p);
+      }
+      erase(*p);
+      merged++;
+    }
+    return merged;
+  }
+
+  ReductionStats CommunicationNet::reduce_(const ReductionRules &rules, pinned_t pinned) {
+    // the elements referred by unresolved elements are connected later
+    for (const Element<UnresolvedPlace> &up : unresolved_places_) {
+      pinned.insert(&up->place);
+    }
+    for (const Element<UnresolvedTransition> &ut : unresolved_transitions_) {
+      pinned.insert(&ut->transition);
+    }
+
+    ReductionStats stats;
+    size_t places = places_.size();
+    size_t transitions = transitions_.size();
+
+    auto apply = [&](Reduction rule, auto rule_fn) {
+      if (!rules[rule]) {
+        return false;
+      }
+      size_t applied = rule_fn();
+      stats[rule] += applied;
+      return applied > 0;
+    };
+
+    bool changed = !rules.empty();
+    while (changed) {
+      stats.rounds++;
+      changed = false;
+      changed |= apply(Reduction::COLLAPSE, [&] { return collapse_chains(); });
+      changed |= apply(Reduction::SELF_LOOPS, [&] { return remove_self_loops(pinned); });
+      changed |= apply(Reduction::DEAD_PLACES, [&] { return remove_dead_places(pinned); });
+      changed |= apply(Reduction::IDENTITY_TRANSITIONS,
+                       [&] { return remove_identity_transitions(pinned); });
+      changed |= apply(Reduction::SERIES_FUSION, [&] { return fuse_series(pinned); });
+      changed |= apply(Reduction::EQUIVALENT_PLACES,
+                       [&] { return merge_equivalent_places(pinned); });
+      changed |= apply(Reduction::PARALLEL_PATHS, [&] { return reduce_parallel_paths(); });
+    }
+
+    stats.removed_places = places - places_.size();
+    stats.removed_transitions = transitions - transitions_.size();
+    return stats;
+  }
+
+  // + public methods
+  void CommunicationNet::collapse() {
+    collapse_chains();
     reduce_parallel_paths();
   }
 
+  ReductionStats CommunicationNet::reduce(const ReductionRules &rules) {
+    return reduce_(rules, {});
+  }
+
   void CommunicationNet::takeover(CommunicationNet cn) {
-    takeover_(places_, cn.places());
-    takeover_(transitions_, cn.transitions());
-    takeover_(unresolved_places_, cn.unresolved_places());
-    takeover_(unresolved_transitions_, cn.unresolved_transitions());
+    arena_.adopt(cn.arena_);
+    splice_(places_, cn.places_);
+    splice_(transitions_, cn.transitions_);
+    splice_(unresolved_places_, cn.unresolved_places_);
+    splice_(unresolved_transitions_, cn.unresolved_transitions_);
   }
 
 } // end of communication net (cn) namespace
@@ -0,0 +1,202 @@
+#include "morpheus/ADT/FrozenNet.hpp"
+
+#include "llvm/ADT/DenseMap.h"
+
+namespace cn {
+
+  using namespace llvm;
+
+  FrozenNet::FrozenNet(const AddressableCN &acn)
+    : id_(acn.get_id()),
+      embedded_id_(acn.embedded_cn.get_id()),
+      address_(acn.address),
+      symbols_(acn.arena()->shared_symbols()) {
+
+    size_t places = distance(acn.places().begin(), acn.places().end()) +
+                    distance(acn.embedded_cn.places().begin(), acn.embedded_cn.places().end());
+    size_t nodes = places + distance(acn.embedded_cn.transitions().begin(),
+                                     acn.embedded_cn.transitions().end());
+    ids_.reserve(nodes);
+    names_.reserve(nodes);
+    types_.reserve(places);
+    init_exprs_.reserve(places);
+
+    // number the nodes
+    DenseMap<const NetElement *, Index> indices(nodes);
+    size_t edges = 0;
+    auto add_node = [&](const NetElement &elem) {
+      indices[&elem] = ids_.size();
+      ids_.push_back(elem.get_id());
+      names_.push_back(elem.name);
+      edges += elem.leads_to.size();
+    };
+    auto add_place = [&](const Place &p) {
+      add_node(p);
+      types_.push_back(p.type);
+      init_exprs_.push_back(p.init_expr);
+    };
+
+    for (const Element<Place> &p : acn.places()) {
+      add_place(*p);
+    }
+    interface_end_ = ids_.size();
+
+    for (const Element<Place> &p : acn.embedded_cn.places()) {
+      add_place(*p);
+    }
+    places_end_ = ids_.size();
+
+    guard_offsets_.push_back(0);
+    for (const Element<Transition> &t : acn.embedded_cn.transitions()) {
+      add_node(*t);
+      guards_.insert(guards_.end(), t->guard.begin(), t->guard.end());
+      guard_offsets_.push_back(guards_.size());
+    }
+
+    auto index_of = [&](const Place &p) {
+      auto it = indices.find(&p);
+      assert (it != indices.end() && "The special place of ACN is not in the net.");
+      return it->second;
+    };
+    asr_ = index_of(acn.asr);
+    arr_ = index_of(acn.arr);
+    csr_ = index_of(acn.csr);
+    crr_ = index_of(acn.crr);
+    // NOTE: the entry and exit places may be gone once the net is collapsed
+    auto index_or_none = [&](const Place &p) {
+      auto it = indices.find(&p);
+      return it != indices.end() ? it->second : NO_NODE;
+    };
+    entry_ = index_or_none(acn.entry_place());
+    exit_ = index_or_none(acn.exit_place());
+
+    // store the outgoing edges of nodes category by category
+    DenseMap<const Edge *, Index> edge_indices(edges);
+    auto add_edges = [&](const NetElement &elem, EdgeCategory category) {
+      Index startpoint = indices.lookup(&elem);
+      for (const Element<Edge> &e : elem.leads_to.of(category)) {
+        auto it = indices.find(&e->endpoint);
+        assert (it != indices.end() && "The edge leads out of the frozen net.");
+
+        edge_indices[e.get()] = endpoints_.size();
+        startpoints_.push_back(startpoint);
+        endpoints_.push_back(it->second);
+        arc_exprs_.push_back(e->arc_expr);
+        categories_.push_back(category);
+        types_of_edges_.push_back(e->get_type());
+      }
+      out_offsets_.push_back(endpoints_.size());
+    };
+
+    out_offsets_.reserve(2 * nodes + 1);
+    startpoints_.reserve(edges);
+    endpoints_.reserve(edges);
+    arc_exprs_.reserve(edges);
+    categories_.reserve(edges);
+    types_of_edges_.reserve(edges);
+    out_offsets_.push_back(0);
+    auto add_node_edges = [&](const NetElement &elem) {
+      add_edges(elem, REGULAR);
+      add_edges(elem, CONTROL_FLOW);
+    };
+    for (const Element<Place> &p : acn.places()) {
+      add_node_edges(*p);
+    }
+    for (const Element<Place> &p : acn.embedded_cn.places()) {
+      add_node_edges(*p);
+    }
+    for (const Element<Transition> &t : acn.embedded_cn.transitions()) {
+      add_node_edges(*t);
+    }
+
+    // store the incoming edges in the order of `referenced_by`
+    in_offsets_.reserve(nodes + 1);
+    in_offsets_.push_back(0);
+    in_edges_.reserve(edges);
+    auto add_incoming = [&](const NetElement &elem) {
+      for (const Edge *e : elem.referenced_by) {
+        in_edges_.push_back(edge_indices.lookup(e));
+      }
+      in_offsets_.push_back(in_edges_.size());
+    };
+    for (const Element<Place> &p : acn.places()) {
+      add_incoming(*p);
+    }
+    for (const Element<Place> &p : acn.embedded_cn.places()) {
+      add_incoming(*p);
+    }
+    for (const Element<Transition> &t : acn.embedded_cn.transitions()) {
+      add_incoming(*t);
+    }
+  }
+
+  ThawedElements FrozenNet::thaw_elements_() const {
+    // NOTE: the thawed net shares the symbols with the snapshot
+    SymbolTable::Scope symbols(symbols_);
+
+    ThawedElements elements;
+    elements.places.reserve(places_end_);
+    for (Index p = 0; p < places_end_; p++) {
+      elements.places.emplace_back(elements.arena->create<Place>(
+        ids_[p], names_[p], types_[p], init_exprs_[p]));
+    }
+
+    elements.transitions.reserve(ids_.size() - places_end_);
+    for (const TransitionRef &t : transitions()) {
+      ArrayRef<Symbol> guard = t.guard();
+      elements.transitions.emplace_back(elements.arena->create<Transition>(
+        t.get_id(), t.name(), Guard(guard.begin(), guard.end())));
+    }
+    return elements;
+  }
+
+  void FrozenNet::restore_(AddressableCN &acn, ThawedElements &&elements) const {
+    vector<NetElement *> nodes;
+    nodes.reserve(ids_.size());
+    for (Index p = 0; p < places_end_; p++) {
+      nodes.push_back(elements.places[p].get());
+      CommunicationNet &cn = p < interface_end_ ? acn : acn.embedded_cn;
+      cn.add_(move(elements.places[p]), cn.places_);
+    }
+    for (Element<Transition> &t : elements.transitions) {
+      nodes.push_back(t.get());
+      acn.embedded_cn.add_(move(t), acn.embedded_cn.transitions_);
+    }
+
+    // the edges are added in the order of storage, hence the outgoing edges keep their order
+    vector<Edge *> edges;
+    edges.reserve(edges_size());
+    for (Index e = 0; e < edges_size(); e++) {
+      Element<Edge> edge = acn.create_edge_(*nodes[startpoints_[e]], *nodes[endpoints_[e]],
+                                            arc_exprs_[e], categories_[e], types_of_edges_[e]);
+      edges.push_back(&acn.add_edge_(move(edge)));
+    }
+
+    // restore the order of incoming edges
+    for (Index n = 0; n < nodes.size(); n++) {
+      vector<Edge *> referenced_by;
+      referenced_by.reserve(in_offsets_[n + 1] - in_offsets_[n]);
+      for (Index i = in_offsets_[n]; i < in_offsets_[n + 1]; i++) {
+        referenced_by.push_back(edges[in_edges_[i]]);
+      }
+      CommunicationNet::reorder_referenced_by_(*nodes[n], move(referenced_by));
+    }
+  }
+
+  AddressableCN::AddressableCN(const FrozenNet &net)
+    : AddressableCN(net, net.thaw_elements_()) { }
+
+  AddressableCN::AddressableCN(const FrozenNet &net, ThawedElements &&elements)
+    : CommunicationNet(elements.arena, net.get_id()),
+      address(net.address()),
+      asr(*elements.places[net.asr_]),
+      arr(*elements.places[net.arr_]),
+      csr(*elements.places[net.csr_]),
+      crr(*elements.places[net.crr_]),
+      embedded_cn(arena(), net.get_embedded_id()),
+      entry_p_(net.entry_ != FrozenNet::NO_NODE ? elements.places[net.entry_].get() : nullptr),
+      exit_p_(net.exit_ != FrozenNet::NO_NODE ? elements.places[net.exit_].get() : nullptr) {
+    net.restore_(*this, move(elements));
+  }
+
+} // end of communication net (cn) namespace
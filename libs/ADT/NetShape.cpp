@@ -0,0 +1,267 @@
+#include "morpheus/ADT/NetShape.hpp"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/LEB128.h"
+#include "llvm/Support/SHA1.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+
+#include <algorithm>
+
+namespace cn {
+
+  using namespace llvm;
+
+  // NOTE: The colours decide the canonical order of nodes, which the digest
+  //       of shapes depends on. Hence they are computed by xxHash, which is
+  //       the same in all processes, unlike `hash_code`.
+  static uint64_t hash_words(ArrayRef<uint64_t> words) {
+    return xxHash64(StringRef(reinterpret_cast<const char *>(words.data()),
+                              words.size() * sizeof(uint64_t)));
+  }
+
+  static uint64_t hash_symbol(Symbol sym) {
+    // NOTE: the contents are hashed, the entries differ among the tables
+    return xxHash64(sym.ref());
+  }
+
+  static size_t count_classes(const vector<uint64_t> &colours) {
+    vector<uint64_t> sorted(colours.begin(), colours.end());
+    std::sort(sorted.begin(), sorted.end());
+    return std::unique(sorted.begin(), sorted.end()) - sorted.begin();
+  }
+
+  template <typename Range>
+  static size_t count_elements(const Range &range) {
+    return distance(range.begin(), range.end());
+  }
+
+  NetShape::NetShape(const CommunicationNet &net)
+    : unresolved_places_(count_elements(net.unresolved_places())),
+      unresolved_transitions_(count_elements(net.unresolved_transitions())) {
+
+    vector<const NetElement *> nodes;
+    for (const Element<Place> &p : net.places()) {
+      nodes.push_back(p.get());
+    }
+    for (const Element<Transition> &t : net.transitions()) {
+      nodes.push_back(t.get());
+    }
+    build_(nodes);
+  }
+
+  NetShape::NetShape(const AddressableCN &acn)
+    : unresolved_places_(count_elements(acn.unresolved_places()) +
+                         count_elements(acn.embedded_cn.unresolved_places())),
+      unresolved_transitions_(count_elements(acn.unresolved_transitions()) +
+                              count_elements(acn.embedded_cn.unresolved_transitions())) {
+
+    vector<const NetElement *> nodes;
+    for (const CommunicationNet *net : {static_cast<const CommunicationNet *>(&acn),
+                                        &acn.embedded_cn}) {
+      for (const Element<Place> &p : net->places()) {
+        nodes.push_back(p.get());
+      }
+      for (const Element<Transition> &t : net->transitions()) {
+        nodes.push_back(t.get());
+      }
+    }
+    build_(nodes);
+  }
+
+  void NetShape::build_(const vector<const NetElement *> &nodes) {
+    Index n = nodes.size();
+    DenseMap<const NetElement *, Index> indices(n);
+    for (Index i = 0; i < n; i++) {
+      indices[nodes[i]] = i;
+    }
+
+    // -------------------------------------------------------
+    // collect the edges and the initial colours of nodes
+
+    vector<EdgeShape> edges;
+    vector<uint64_t> edge_labels;
+    vector<Index> out_offsets(1, 0);
+    vector<uint64_t> colours;
+    colours.reserve(n);
+
+    for (Index i = 0; i < n; i++) {
+      const NetElement &elem = *nodes[i];
+      if (const Place *p = dyn_cast<Place>(&elem)) {
+        colours.push_back(hash_words({uint64_t(p->get_kind()), hash_symbol(p->type),
+                                      hash_symbol(p->init_expr)}));
+      } else {
+        const Transition &t = cast<Transition>(elem);
+        vector<uint64_t> guard(1, uint64_t(t.get_kind()));
+        for (Symbol g : t.guard) {
+          guard.push_back(hash_symbol(g));
+        }
+        colours.push_back(hash_words(guard));
+      }
+
+      for (EdgeCategory category : {REGULAR, CONTROL_FLOW}) {
+        for (const Element<Edge> &e : elem.leads_to.of(category)) {
+          auto it = indices.find(&e->endpoint);
+          Index endpoint = it != indices.end() ? it->second : EXTERNAL;
+          edges.push_back({i, endpoint, e->arc_expr, category, e->get_type()});
+          edge_labels.push_back(hash_words({hash_symbol(e->arc_expr), uint64_t(category),
+                                            uint64_t(e->get_type())}));
+        }
+      }
+      out_offsets.push_back(edges.size());
+    }
+
+    // the internal edges entering the node `n` are incoming[in_offsets[n], in_offsets[n + 1])
+    vector<Index> in_offsets(n + 1, 0);
+    for (const EdgeShape &e : edges) {
+      if (e.endpoint != EXTERNAL) {
+        in_offsets[e.endpoint + 1]++;
+      }
+    }
+    for (Index i = 0; i < n; i++) {
+      in_offsets[i + 1] += in_offsets[i];
+    }
+    vector<Index> incoming(in_offsets.back());
+    vector<Index> filled(in_offsets.begin(), in_offsets.end() - 1);
+    for (Index e = 0; e < edges.size(); e++) {
+      if (edges[e].endpoint != EXTERNAL) {
+        incoming[filled[edges[e].endpoint]++] = e;
+      }
+    }
+
+    // -------------------------------------------------------
+    // refine the colours by the neighbourhoods of nodes until
+    // the number of colour classes stabilizes
+
+    size_t classes = count_classes(colours);
+    vector<uint64_t> refined(n);
+    vector<uint64_t> signature;
+    for (unsigned round = 0; round < MAX_REFINEMENTS; round++) {
+      for (Index i = 0; i < n; i++) {
+        signature.clear();
+        for (Index e = out_offsets[i]; e < out_offsets[i + 1]; e++) {
+          Index endpoint = edges[e].endpoint;
+          signature.push_back(hash_words(
+            {edge_labels[e], endpoint != EXTERNAL ? colours[endpoint] : uint64_t(EXTERNAL)}));
+        }
+        std::sort(signature.begin(), signature.end());
+        uint64_t out = hash_words(signature);
+
+        signature.clear();
+        for (Index in = in_offsets[i]; in < in_offsets[i + 1]; in++) {
+          Index e = incoming[in];
+          signature.push_back(hash_words({edge_labels[e], colours[edges[e].startpoint]}));
+        }
+        std::sort(signature.begin(), signature.end());
+        uint64_t in = hash_words(signature);
+
+        refined[i] = hash_words({colours[i], out, in});
+      }
+      colours.swap(refined);
+
+      size_t refined_classes = count_classes(colours);
+      if (refined_classes == classes) {
+        break;
+      }
+      classes = refined_classes;
+    }
+
+    // -------------------------------------------------------
+    // store the nodes and edges in the canonical order
+
+    vector<Index> order(n);
+    for (Index i = 0; i < n; i++) {
+      order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](Index a, Index b) {
+      return colours[a] < colours[b];
+    });
+    vector<Index> canonical(n);
+    for (Index i = 0; i < n; i++) {
+      canonical[order[i]] = i;
+    }
+
+    kinds_.reserve(n);
+    label_offsets_.reserve(n + 1);
+    label_offsets_.push_back(0);
+    edges_.reserve(edges.size());
+    for (Index i : order) {
+      const NetElement &elem = *nodes[i];
+      kinds_.push_back(elem.get_kind());
+      if (const Place *p = dyn_cast<Place>(&elem)) {
+        labels_.push_back(p->type);
+        labels_.push_back(p->init_expr);
+      } else {
+        const Guard &guard = cast<Transition>(elem).guard;
+        labels_.insert(labels_.end(), guard.begin(), guard.end());
+      }
+      label_offsets_.push_back(labels_.size());
+
+      for (Index e = out_offsets[i]; e < out_offsets[i + 1]; e++) {
+        EdgeShape edge = edges[e];
+        edge.startpoint = canonical[i];
+        if (edge.endpoint != EXTERNAL) {
+          edge.endpoint = canonical[edge.endpoint];
+        }
+        edges_.push_back(edge);
+      }
+    }
+
+    // NOTE: the multiset of colours does not depend on the order of nodes
+    vector<uint64_t> sorted(colours.begin(), colours.end());
+    std::sort(sorted.begin(), sorted.end());
+    hash_ = hash_combine(n, edges_.size(), unresolved_places_, unresolved_transitions_,
+                         hash_combine_range(sorted.begin(), sorted.end()));
+  }
+
+  std::string NetShape::digest() const {
+    SmallString<1024> buffer;
+    raw_svector_ostream os(buffer);
+    auto write_symbol = [&](Symbol sym) {
+      StringRef str = sym.ref();
+      encodeULEB128(str.size(), os);
+      os << str;
+    };
+
+    encodeULEB128(kinds_.size(), os);
+    encodeULEB128(edges_.size(), os);
+    encodeULEB128(unresolved_places_, os);
+    encodeULEB128(unresolved_transitions_, os);
+    for (size_t i = 0; i < kinds_.size(); i++) {
+      encodeULEB128(unsigned(kinds_[i]), os);
+      encodeULEB128(label_offsets_[i + 1] - label_offsets_[i], os);
+      for (Index l = label_offsets_[i]; l < label_offsets_[i + 1]; l++) {
+        write_symbol(labels_[l]);
+      }
+    }
+    for (const EdgeShape &e : edges_) {
+      encodeULEB128(e.startpoint, os);
+      encodeULEB128(e.endpoint, os);
+      write_symbol(e.arc_expr);
+      encodeULEB128(unsigned(e.category), os);
+      encodeULEB128(unsigned(e.type), os);
+    }
+
+    SHA1 sha;
+    sha.update(os.str());
+    std::string hex;
+    raw_string_ostream hex_os(hex);
+    for (uint8_t byte : sha.final()) {
+      hex_os << format_hex_no_prefix(byte, 2);
+    }
+    return hex_os.str();
+  }
+
+  bool NetShape::operator==(const NetShape &shape) const {
+    return (hash_ == shape.hash_ &&
+            unresolved_places_ == shape.unresolved_places_ &&
+            unresolved_transitions_ == shape.unresolved_transitions_ &&
+            kinds_ == shape.kinds_ &&
+            label_offsets_ == shape.label_offsets_ &&
+            labels_ == shape.labels_ &&
+            edges_ == shape.edges_);
+  }
+
+} // end of communication net (cn) namespace
@@ -0,0 +1,335 @@
+#include "morpheus/ADT/SubnetTable.hpp"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/ScopeExit.h"
+#include "llvm/ADT/StringExtras.h"
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <string>
+
+namespace cn {
+
+  using namespace llvm;
+
+  namespace {
+
+  using Index = SubnetShape::Index;
+  using ID = SubnetShape::ID;
+
+  hash_code hash_symbol(Symbol sym) {
+    return hash_value(sym.ref());
+  }
+
+  // Splits the name around the first number within [`first`, `last`],
+  // i.e. around an ID of the net or of one of its subnets.
+  void split_name(SubnetShape::Node &node, Symbol name, ID first, ID last,
+                  SymbolTable &symbols) {
+    StringRef str = name.ref();
+    for (size_t begin = 0; begin < str.size(); ) {
+      if (!isDigit(str[begin])) {
+        begin++;
+        continue;
+      }
+      size_t end = begin;
+      while (end < str.size() && isDigit(str[end])) {
+        end++;
+      }
+
+      StringRef digits = str.slice(begin, end);
+      unsigned long long value;
+      // NOTE: the number has to be printed back the same way (no leading zeros)
+      if ((digits.size() == 1 || digits[0] != '0') &&
+          !digits.getAsInteger(10, value) && first <= value && value <= last) {
+        node.prefix = symbols.intern(str.slice(0, begin));
+        node.suffix = symbols.intern(str.slice(end, str.size()));
+        node.numbered = true;
+        node.number = ID(value) - first;
+        return;
+      }
+      begin = end;
+    }
+    node.prefix = name;
+    node.numbered = false;
+    node.number = 0;
+  }
+
+  // Orders the edges so that all the given chains are kept, i.e. each edge
+  // of a chain is created after the preceding one. Among the edges that can
+  // be created next, the first discovered one is taken.
+  vector<Index> creation_order(size_t edges, const vector<vector<Index>> &chains) {
+    vector<vector<Index>> successors(edges);
+    vector<size_t> predecessors(edges, 0);
+    for (const vector<Index> &chain : chains) {
+      for (size_t i = 1; i < chain.size(); i++) {
+        successors[chain[i - 1]].push_back(chain[i]);
+        predecessors[chain[i]]++;
+      }
+    }
+
+    priority_queue<Index, vector<Index>, greater<Index>> ready;
+    for (Index e = 0; e < edges; e++) {
+      if (!predecessors[e]) {
+        ready.push(e);
+      }
+    }
+
+    vector<Index> order;
+    order.reserve(edges);
+    while (!ready.empty()) {
+      Index e = ready.top();
+      ready.pop();
+      order.push_back(e);
+      for (Index s : successors[e]) {
+        if (!--predecessors[s]) {
+          ready.push(s);
+        }
+      }
+    }
+    // NOTE: the chains come from a single net, hence they are never cyclic
+    assert(order.size() == edges && "The chains of edges cannot form a cycle.");
+    return order;
+  }
+
+  } // end of anonymous namespace
+
+  bool SubnetShape::Node::operator==(const Node &node) const {
+    return kind == node.kind && id == node.id && prefix == node.prefix &&
+           suffix == node.suffix && numbered == node.numbered && number == node.number &&
+           type == node.type && init_expr == node.init_expr && guard == node.guard;
+  }
+
+  // ---------------------------------------------------------------------------
+  // SharedSubnetCN
+
+  SharedSubnetCN::SharedSubnetCN(const NetArenaRef &arena,
+                                 std::shared_ptr<const SubnetShape> shape,
+                                 PluginCNBase &pcn)
+    : PluginCNBase(arena, pcn.get_id(),
+                   *arena->create<Place>(pcn.entry_place().get_id(), pcn.entry_place().name,
+                                         pcn.entry_place().type, pcn.entry_place().init_expr),
+                   *arena->create<Place>(pcn.exit_place().get_id(), pcn.exit_place().name,
+                                         pcn.exit_place().type, pcn.exit_place().init_expr)),
+      shape_(std::move(shape)),
+      entry_(&entry_place()),
+      exit_(&exit_place()) { }
+
+  void SharedSubnetCN::connect(AddressableCN &acn) {
+    assert(entry_ && exit_ && "The shared net can be connected only once.");
+    const SubnetShape &shape = *shape_;
+    SymbolTable &symbols = arena()->symbols();
+
+    vector<NetElement *> nodes;
+    nodes.reserve(shape.nodes.size() + 4);
+    for (Index i = 0; i < shape.nodes.size(); i++) {
+      const SubnetShape::Node &node = shape.nodes[i];
+      if (i == shape.entry) {
+        nodes.push_back(&add_place(std::move(entry_)));
+        continue;
+      }
+      if (i == shape.exit) {
+        nodes.push_back(&add_place(std::move(exit_)));
+        continue;
+      }
+
+      Symbol name = node.prefix;
+      if (node.numbered) {
+        name = symbols.intern(node.prefix.str() + std::to_string(get_id() + node.number) +
+                              node.suffix.str());
+      }
+      if (node.kind == NetElement::Kind::PLACE) {
+        nodes.push_back(&add_place(make_element_<Place>(get_id() + node.id, name,
+                                                        node.type, node.init_expr)));
+      } else {
+        nodes.push_back(&add_transition(make_element_<Transition>(get_id() + node.id, name,
+                                                                  node.guard)));
+      }
+    }
+    nodes.insert(nodes.end(), {&acn.asr, &acn.arr, &acn.csr, &acn.crr});
+
+    for (const SubnetShape::EdgeShape &e : shape.edges) {
+      add_edge_(create_edge_(*nodes[e.startpoint], *nodes[e.endpoint], e.arc_expr,
+                             e.category, e.type));
+    }
+  }
+
+  // ---------------------------------------------------------------------------
+  // SubnetTable
+
+  SubnetTable::SubnetTable() {
+    Identifiable::IDAllocator::Scope ids(scratch_ids_);
+    scratch_ = std::make_unique<AddressableCN>(0);
+  }
+
+  std::shared_ptr<const SubnetShape> SubnetTable::intern(PluginCNBase &pcn) {
+    if (pcn.has_unresolved()) {
+      return nullptr;
+    }
+
+    // number the nodes, the interface places of the scratch net follow them
+    vector<NetElement *> nodes;
+    for (const Element<Place> &p : pcn.places()) {
+      nodes.push_back(p.get());
+    }
+    size_t places = nodes.size();
+    for (const Element<Transition> &t : pcn.transitions()) {
+      nodes.push_back(t.get());
+    }
+    size_t nodes_size = nodes.size();
+    nodes.insert(nodes.end(), {&scratch_->asr, &scratch_->arr, &scratch_->csr, &scratch_->crr});
+
+    DenseMap<const NetElement *, Index> indices(nodes.size());
+    for (Index i = 0; i < nodes.size(); i++) {
+      indices[nodes[i]] = i;
+    }
+
+    // the numbers of edges of the nodes before they are connected
+    struct Sizes {
+      size_t regular, control_flow, referenced_by;
+    };
+    vector<Sizes> sizes;
+    sizes.reserve(nodes_size);
+    for (size_t i = 0; i < nodes_size; i++) {
+      sizes.push_back({nodes[i]->leads_to.of(REGULAR).size(),
+                       nodes[i]->leads_to.of(CONTROL_FLOW).size(),
+                       nodes[i]->referenced_by.size()});
+    }
+
+    // NOTE: `connect` may create further elements, their IDs must not be
+    //       taken from the nets
+    {
+      Identifiable::IDAllocator::Scope ids(scratch_ids_);
+      pcn.connect(*scratch_);
+    }
+
+    // NOTE: the edges made by `connect` are removed before returning, hence
+    //       the net can still be plugged in if it is not shared
+    auto disconnect = make_scope_exit([&] {
+      for (const Element<Place> &p : scratch_->places()) {
+        p->leads_to.of(REGULAR).clear();
+        p->leads_to.of(CONTROL_FLOW).clear();
+        p->referenced_by.clear();
+      }
+      for (size_t i = 0; i < nodes_size; i++) {
+        Elements<Edge> &regular = nodes[i]->leads_to.of(REGULAR);
+        Elements<Edge> &control_flow = nodes[i]->leads_to.of(CONTROL_FLOW);
+        regular.erase(regular.begin() + sizes[i].regular, regular.end());
+        control_flow.erase(control_flow.begin() + sizes[i].control_flow, control_flow.end());
+        nodes[i]->referenced_by.resize(sizes[i].referenced_by);
+      }
+    });
+
+    if (pcn.has_unresolved() ||
+        size_t(distance(pcn.places().begin(), pcn.places().end())) != places ||
+        size_t(distance(pcn.transitions().begin(), pcn.transitions().end())) != nodes_size - places) {
+      return nullptr;
+    }
+    for (const Element<Place> &p : scratch_->places()) {
+      bool interface = indices.count(p.get());
+      if (!interface && (!p->leads_to.empty() || !p->referenced_by.empty())) {
+        return nullptr; // connected to the entry or exit place of ACN
+      }
+    }
+
+    auto entry = indices.find(&pcn.entry_place());
+    auto exit = indices.find(&pcn.exit_place());
+    if (entry == indices.end() || exit == indices.end() ||
+        entry->second >= nodes_size || exit->second >= nodes_size) {
+      return nullptr;
+    }
+
+    // collect the edges with the chains of their order within the elements
+    vector<const Edge *> edges;
+    DenseMap<const Edge *, Index> edge_indices;
+    vector<vector<Index>> chains;
+    for (NetElement *elem : nodes) {
+      for (EdgeCategory category : {REGULAR, CONTROL_FLOW}) {
+        vector<Index> chain;
+        for (const Element<Edge> &e : elem->leads_to.of(category)) {
+          if (!indices.count(&e->endpoint) || &e->endpoint == nodes[entry->second] ||
+              &e->startpoint == nodes[exit->second]) {
+            // the edges of entry and exit places are mixed with the edges of
+            // the enclosing net, hence their order could not be kept
+            return nullptr;
+          }
+          chain.push_back(edges.size());
+          edge_indices[e.get()] = edges.size();
+          edges.push_back(e.get());
+        }
+        chains.push_back(std::move(chain));
+      }
+    }
+    for (NetElement *elem : nodes) {
+      vector<Index> chain;
+      for (const Edge *e : elem->referenced_by) {
+        auto it = edge_indices.find(e);
+        if (it == edge_indices.end()) {
+          return nullptr;
+        }
+        chain.push_back(it->second);
+      }
+      chains.push_back(std::move(chain));
+    }
+
+    // freeze the net
+    auto shape = std::make_shared<SubnetShape>();
+    SymbolTable &symbols = pcn.arena()->symbols();
+    ID base = pcn.get_id();
+    ID last = base;
+    for (size_t i = 0; i < nodes_size; i++) {
+      last = std::max(last, nodes[i]->get_id());
+    }
+
+    hash_code hash = hash_combine(places, nodes_size, entry->second, exit->second);
+    shape->nodes.reserve(nodes_size);
+    for (size_t i = 0; i < nodes_size; i++) {
+      SubnetShape::Node node;
+      node.kind = nodes[i]->get_kind();
+      node.id = nodes[i]->get_id() - base;
+      split_name(node, nodes[i]->name, base, last, symbols);
+      if (const Place *p = dyn_cast<Place>(nodes[i])) {
+        node.type = p->type;
+        node.init_expr = p->init_expr;
+      } else {
+        node.guard = cast<Transition>(nodes[i])->guard;
+      }
+
+      hash = hash_combine(hash, node.kind, node.id, hash_symbol(node.prefix),
+                          hash_symbol(node.suffix), node.numbered, node.number,
+                          hash_symbol(node.type), hash_symbol(node.init_expr));
+      for (Symbol cond : node.guard) {
+        hash = hash_combine(hash, hash_symbol(cond));
+      }
+      shape->nodes.push_back(std::move(node));
+    }
+
+    shape->edges.reserve(edges.size());
+    for (Index e : creation_order(edges.size(), chains)) {
+      const Edge &edge = *edges[e];
+      SubnetShape::EdgeShape es{indices[&edge.startpoint], indices[&edge.endpoint],
+                                edge.arc_expr, edge.get_category(), edge.get_type()};
+      hash = hash_combine(hash, es.startpoint, es.endpoint, hash_symbol(es.arc_expr),
+                          es.category, es.type);
+      shape->edges.push_back(es);
+    }
+    shape->entry = entry->second;
+    shape->exit = exit->second;
+    shape->hash = hash;
+
+    // intern the shape
+    instances_++;
+    std::vector<std::shared_ptr<const SubnetShape>> &bucket = shapes_[shape->hash];
+    for (const std::shared_ptr<const SubnetShape> &interned : bucket) {
+      if (*interned == *shape) {
+        return interned;
+      }
+    }
+    bucket.push_back(shape);
+    shapes_size_++;
+    return shape;
+  }
+
+} // end of communication net (cn) namespace
@@ -1,7 +1,16 @@
 
 #include "morpheus/Analysis/MPILabellingAnalysis.hpp"
 
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/SCCIterator.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/CommandLine.h"
+
+#include <algorithm>
 #include <cassert>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 
 using namespace llvm;
@@ -9,28 +18,352 @@ using namespace llvm;
 // -------------------------------------------------------------------------- //
 // MPILabellingAnalysis
 
+static cl::opt<unsigned> labelling_jobs(
+    "labelling-jobs", cl::init(1),
+    cl::desc("Number of threads labelling the call graph (the labels do not depend on it)."));
+
 MPILabelling
 MPILabellingAnalysis::run (Module &m, ModuleAnalysisManager &mam) {
 
   CallGraph &cg = mam.getResult<CallGraphAnalysis>(m);
-  return MPILabelling(cg);
+  return MPILabelling(cg, labelling_jobs);
 }
 
 // provide definition of the analysis Key
 AnalysisKey MPILabellingAnalysis::Key;
 
 
+// -------------------------------------------------------------------------- //
+// LabellingGraph
+
+namespace {
+  // LabellingGraph is the call graph extended by a root that calls all the
+  // functions of the module, hence scc_iterator visits all of them and not
+  // only those reachable from the external calling node.
+  struct LabellingNode {
+    CallGraphNode const *cgn; // null for the root
+    std::vector<LabellingNode *> callees;
+  };
+
+  struct LabellingGraph {
+    LabellingNode root;
+    std::vector<LabellingNode> nodes;
+    DenseMap<CallGraphNode const *, LabellingNode *> node_of;
+
+    explicit LabellingGraph(CallGraph &cg) : root{nullptr, {}} {
+      // NOTE: the nodes are reserved up front as they are referenced by pointers,
+      //       they are in the order of the module to get the same labelling in each run
+      nodes.reserve(cg.getModule().size());
+      for (const Function &f : cg.getModule()) {
+        CallGraphNode const *cgn = cg[&f];
+        nodes.push_back({cgn, {}});
+        node_of[cgn] = &nodes.back();
+        root.callees.push_back(&nodes.back());
+      }
+
+      for (LabellingNode &n : nodes) {
+        for (const CallGraphNode::CallRecord &cr : *n.cgn) {
+          auto search = node_of.find(cr.second);
+          if (search != node_of.end()) { // nodes without a function are not labelled
+            n.callees.push_back(search->second);
+          }
+        }
+      }
+    }
+
+    size_t index(LabellingNode const *n) const { return n - nodes.data(); }
+  };
+} // anonymous namespace
+
+namespace llvm {
+  template <> struct GraphTraits<LabellingGraph *> {
+    using NodeRef = LabellingNode *;
+    using ChildIteratorType = std::vector<LabellingNode *>::iterator;
+
+    static NodeRef getEntryNode(LabellingGraph *g) { return &g->root; }
+    static ChildIteratorType child_begin(NodeRef n) { return n->callees.begin(); }
+    static ChildIteratorType child_end(NodeRef n) { return n->callees.end(); }
+  };
+} // llvm
+
+
+// -------------------------------------------------------------------------- //
+// MPILabelling::Labeller
+
+// Labeller labels the SCCs of the call graph. An SCC is labelled once all
+// the SCCs it calls are labelled, i.e. in the bottom-up order of scc_iterator
+// or concurrently with the SCCs independent of it. The labels of the
+// functions are kept in a vector indexed as the nodes, so that the tasks
+// labelling different SCCs write to disjoint elements.
+//
+// NOTE: The checkpoints are saved into buffers and merged in the order of
+//       SCCs at the end, hence both the modes give the same results.
+class MPILabelling::Labeller {
+
+public:
+  struct Checkpoint {
+    size_t scc;
+    CallSite cs;
+    MPICallType call_type;
+  };
+  using Checkpoints = std::vector<Checkpoint>;
+
+  explicit Labeller(CallGraph &cg) : graph_(cg), labels_(graph_.nodes.size(), SEQUENTIAL) {
+    // the SCCs in the bottom-up order
+    std::vector<size_t> scc_of(graph_.nodes.size());
+    for (auto it = scc_begin(&graph_); !it.isAtEnd(); ++it) {
+      std::vector<LabellingNode *> scc;
+      for (LabellingNode *n : *it) {
+        if (n->cgn) { // skip the root
+          scc_of[graph_.index(n)] = sccs_.size();
+          scc.push_back(n);
+        }
+      }
+      if (!scc.empty()) {
+        sccs_.push_back(std::move(scc));
+      }
+    }
+
+    // the DAG of SCCs, `last_caller` filters out the repeated edges
+    callers_.resize(sccs_.size());
+    callees_count_.resize(sccs_.size(), 0);
+    std::vector<size_t> last_caller(sccs_.size(), sccs_.size());
+    for (size_t i = 0; i < sccs_.size(); ++i) {
+      for (LabellingNode const *n : sccs_[i]) {
+        for (LabellingNode const *callee : n->callees) {
+          size_t j = scc_of[graph_.index(callee)];
+          if (j != i && last_caller[j] != i) {
+            last_caller[j] = i;
+            callers_[j].push_back(i);
+            ++callees_count_[i];
+          }
+        }
+      }
+    }
+  }
+
+  void run(Checkpoints &checkpoints) {
+    for (size_t i = 0; i < sccs_.size(); ++i) {
+      label_scc(i, checkpoints);
+    }
+  }
+
+  // labels the SCCs by `jobs` threads, each of them saves the checkpoints into a buffer of its own
+  void run_parallel(unsigned jobs, std::vector<Checkpoints> &buffers) {
+    buffers.resize(jobs);
+
+    std::vector<size_t> ready;
+    for (size_t i = 0; i < sccs_.size(); ++i) {
+      if (callees_count_[i] == 0) {
+        ready.push_back(i);
+      }
+    }
+    size_t done = 0;
+    std::mutex m;
+    std::condition_variable cv;
+
+    auto work = [&](Checkpoints &checkpoints) {
+      std::unique_lock<std::mutex> lock(m);
+      while (true) {
+        cv.wait(lock, [&] { return !ready.empty() || done == sccs_.size(); });
+        if (ready.empty()) {
+          return;
+        }
+        size_t i = ready.back();
+        ready.pop_back();
+
+        lock.unlock();
+        label_scc(i, checkpoints);
+        lock.lock();
+
+        // the callers of the SCC may be ready now
+        ++done;
+        for (size_t caller : callers_[i]) {
+          if (--callees_count_[caller] == 0) {
+            ready.push_back(caller);
+          }
+        }
+        cv.notify_all();
+      }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned j = 0; j < jobs; ++j) {
+      workers.emplace_back(work, std::ref(buffers[j]));
+    }
+    for (std::thread &w : workers) {
+      w.join();
+    }
+  }
+
+  ExplorationState label(size_t node) const { return labels_[node]; }
+  Function *function(size_t node) const { return graph_.nodes[node].cgn->getFunction(); }
+  size_t size() const { return graph_.nodes.size(); }
+
+private:
+  void label_scc(size_t i, Checkpoints &checkpoints);
+  ExplorationState label_calls(CallGraphNode const *cgn) const;
+  ExplorationState callee_label(CallGraphNode const *cgn) const;
+  void save_checkpoints(size_t i, LabellingNode const *n, Checkpoints &checkpoints) const;
+
+  LabellingGraph graph_;
+  std::vector<ExplorationState> labels_;   // indexed as the nodes
+  std::vector<std::vector<LabellingNode *>> sccs_;
+  std::vector<std::vector<size_t>> callers_; // SCCs calling the SCC
+  std::vector<size_t> callees_count_;        // the number of SCCs called by the SCC
+};
+
+void MPILabelling::Labeller::label_scc(size_t i, Checkpoints &checkpoints) {
+  std::vector<LabellingNode *> const &scc = sccs_[i];
+  DenseSet<LabellingNode const *> members(scc.begin(), scc.end());
+
+  // NOTE: the members of the SCC start as sequential and their labels are
+  //       raised until they are stable. A label is raised at most a few
+  //       times, so the labelling is linear in the size of the call graph.
+  DenseMap<LabellingNode const *, SmallVector<LabellingNode *, 4>> callers;
+  for (LabellingNode *n : scc) {
+    Function *f = n->cgn->getFunction();
+    if (f->hasName() && f->getName().startswith("MPI_")) {
+      labels_[graph_.index(n)] = MPI_CALL;
+      continue;
+    }
+
+    for (LabellingNode const *callee : n->callees) {
+      if (members.count(callee)) {
+        callers[callee].push_back(n);
+      }
+    }
+  }
+
+  std::vector<LabellingNode *> worklist(scc.rbegin(), scc.rend());
+  while (!worklist.empty()) {
+    LabellingNode *n = worklist.back();
+    worklist.pop_back();
+
+    ExplorationState &label = labels_[graph_.index(n)];
+    if (label == MPI_CALL) {
+      continue;
+    }
+
+    ExplorationState es = label_calls(n->cgn);
+    if (label < es) {
+      label = es;
+      // the callers within the SCC may be raised as well
+      auto search = callers.find(n);
+      if (search != callers.end()) {
+        worklist.insert(worklist.end(), search->second.begin(), search->second.end());
+      }
+    }
+  }
+
+  // the checkpoints are saved once the labels of all the callees are final
+  for (LabellingNode const *n : scc) {
+    save_checkpoints(i, n, checkpoints);
+  }
+}
+
+MPILabelling::ExplorationState
+MPILabelling::Labeller::label_calls(CallGraphNode const *cgn) const {
+  ExplorationState res_es = SEQUENTIAL;
+
+  for (const CallGraphNode::CallRecord &cr : *cgn) {
+    ExplorationState inner_es = SEQUENTIAL;
+
+    if (cr.first == nullptr) { // calling external node => black (opaque) transition in the MPN
+      inner_es = EXTERNAL;
+    } else {
+      switch(callee_label(cr.second)) {
+      case MPI_CALL:
+        inner_es = MPI_INVOLVED;
+        break;
+      case MPI_INVOLVED:
+      case MPI_INVOLVED_MEDIATELY:
+        inner_es = MPI_INVOLVED_MEDIATELY;
+        break;
+      case SEQUENTIAL:
+      case EXTERNAL:
+        // do nothing
+        break;
+      }
+    }
+
+    if (res_es < inner_es) {
+      res_es = inner_es;
+    }
+  }
+  return res_es;
+}
+
+MPILabelling::ExplorationState
+MPILabelling::Labeller::callee_label(CallGraphNode const *cgn) const {
+  auto search = graph_.node_of.find(cgn);
+  if (search == graph_.node_of.end()) { // external call
+    return EXTERNAL;
+  }
+  return labels_[graph_.index(search->second)];
+}
+
+void MPILabelling::Labeller::save_checkpoints(size_t i, LabellingNode const *n,
+                                              Checkpoints &checkpoints) const {
+  if (labels_[graph_.index(n)] == MPI_CALL) {
+    return;
+  }
+
+  for (const CallGraphNode::CallRecord &cr : *n->cgn) {
+    if (cr.first == nullptr) {
+      continue;
+    }
+
+    CallSite call_site(cr.first);
+    switch(callee_label(cr.second)) {
+    case MPI_CALL:
+      checkpoints.push_back({i, call_site, MPICallType::DIRECT});
+      break;
+    case MPI_INVOLVED:
+    case MPI_INVOLVED_MEDIATELY:
+      checkpoints.push_back({i, call_site, MPICallType::INDIRECT});
+      break;
+    case SEQUENTIAL:
+    case EXTERNAL:
+      // do nothing
+      break;
+    }
+  }
+}
+
+
 // -------------------------------------------------------------------------- //
 // MPILabelling
 
-MPILabelling::MPILabelling(CallGraph &cg) {
+MPILabelling::MPILabelling(CallGraph &cg, unsigned jobs) {
 
-  // There is no root node
-  for (const auto &node : cg) {
-    CallGraphNode const *cgn = node.second.get();
-    if (cgn->getFunction()) { // explore only function node TODO: check whether is it enough to ignore non-function calls or the reaction should be "better"?
-      explore_cgnode(cgn);
+  Labeller labeller(cg);
+  Labeller::Checkpoints checkpoints;
+  if (jobs > 1) {
+    std::vector<Labeller::Checkpoints> buffers;
+    labeller.run_parallel(jobs, buffers);
+
+    // NOTE: an SCC is labelled by a single thread, hence the stable sort
+    //       keeps the order of checkpoints within the SCC
+    for (Labeller::Checkpoints &buffer : buffers) {
+      checkpoints.insert(checkpoints.end(), buffer.begin(), buffer.end());
     }
+    std::stable_sort(checkpoints.begin(), checkpoints.end(),
+                     [](const Labeller::Checkpoint &a, const Labeller::Checkpoint &b) {
+                       return a.scc < b.scc;
+                     });
+  } else {
+    labeller.run(checkpoints);
+  }
+
+  for (size_t n = 0; n < labeller.size(); ++n) {
+    fn_labels[labeller.function(n)] = labeller.label(n);
+  }
+  for (const Labeller::Checkpoint &cp : checkpoints) {
+    if (cp.call_type == MPICallType::DIRECT) {
+      mpi_calls[cp.cs.getCalledFunction()->getName()].push_back(cp.cs);
+    }
+    save_checkpoint(cp.cs, cp.call_type);
   }
 }
 
@@ -88,70 +421,6 @@ MPILabelling::get_mpi_checkpoints(BasicBlock const *bb) const {
 
 // Private methods ---------------------------------------------------------- //
 
-MPILabelling::ExplorationState
-MPILabelling::explore_cgnode(CallGraphNode const *cgn) {
-  Function *f = cgn->getFunction();
-  if (!f) { // external call
-    return EXTERNAL;
-  }
-
-  auto it = fn_labels.find(f);
-  if (it != fn_labels.end()) {
-    return it->getSecond();
-  }
-
-  if (f->hasName() && f->getName().startswith("MPI_")) {
-    fn_labels[f] = MPI_CALL;
-    return MPI_CALL;
-  }
-
-  // NOTE: store the info that the function is currently being processed.
-  //       This helps to resolve recursive calls as it immediately returns
-  //       PROCESSING status.
-
-  // TODO: => TEST: make a test to simple function calling itself. => it has to end with sequential
-  fn_labels[f] = PROCESSING;
-
-  ExplorationState res_es = SEQUENTIAL;
-
-  for (const CallGraphNode::CallRecord &cr : *cgn) {
-    ExplorationState inner_es = SEQUENTIAL;
-
-    if (cr.first == nullptr) { // calling external node => black (opaque) transition in the MPN
-      inner_es = EXTERNAL;
-    } else {
-      CallSite call_site(cr.first);
-      CallGraphNode *called_cgn = cr.second;
-
-      ExplorationState const &es = explore_cgnode(called_cgn);
-      switch(es) {
-      case MPI_CALL:
-        mpi_calls[call_site.getCalledFunction()->getName()].push_back(call_site);
-        inner_es = MPI_INVOLVED;
-        save_checkpoint(call_site, MPICallType::DIRECT);
-        break;
-      case MPI_INVOLVED:
-      case MPI_INVOLVED_MEDIATELY:
-        inner_es = MPI_INVOLVED_MEDIATELY;
-        save_checkpoint(call_site, MPICallType::INDIRECT);
-        break;
-      case PROCESSING:
-      case SEQUENTIAL:
-      case EXTERNAL:
-        // do nothing
-        break;
-      }
-    }
-
-    if (res_es < inner_es) {
-      res_es = inner_es;
-    }
-  }
-
-  fn_labels[f] = res_es; // set the resulting status
-  return res_es;
-}
-
 void MPILabelling::save_checkpoint(CallSite cs, MPICallType call_type) {
   BasicBlock *bb = cs->getParent();
   assert(bb != nullptr && "Null parent of instruction.");
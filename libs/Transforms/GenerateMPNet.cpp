@@ -1,13 +1,27 @@
 
 #include "llvm/IR/PassManager.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/raw_os_ostream.h"
 
+#include "morpheus/ADT/BinaryNet.hpp"
 #include "morpheus/ADT/CommunicationNet.hpp"
 #include "morpheus/ADT/CommNetFactory.hpp"
+#include "morpheus/ADT/FrozenNet.hpp"
+#include "morpheus/ADT/NetShape.hpp"
+#include "morpheus/ADT/SubnetTable.hpp"
 #include "morpheus/Analysis/MPILabellingAnalysis.hpp"
 #include "morpheus/Analysis/MPIScopeAnalysis.hpp"
 #include "morpheus/Formats/DotGraph.hpp"
+#include "morpheus/Formats/Pnml.hpp"
+#include "morpheus/Formats/ShardedWriter.hpp"
 #include "morpheus/Transforms/GenerateMPNet.hpp"
 
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <string>
+
 using namespace llvm;
 
 void interconnect_basicblock_cns(std::vector<cn::BasicBlockCN> &);
@@ -15,7 +29,66 @@ void interconnect_basicblock_cns(std::vector<cn::BasicBlockCN> &);
 // -------------------------------------------------------------------------- //
 // GenerateMPNetPass
 
+static cl::opt<bool> print_net_digest(
+    "print-net-digest", cl::Hidden,
+    cl::desc("Print the digest of the shape of the generated net (used to deduplicate ranks)."));
+
+static cl::opt<bool> binary_net(
+    "binary-net",
+    cl::desc("Store the raw net also in the binary format (see BinaryNet.hpp)."));
+
+static cl::opt<bool> pnml_net(
+    "pnml-net",
+    cl::desc("Store the raw net also in PNML (e.g. for external model checkers)."));
+
+static cl::opt<bool> stream_net(
+    "stream-net",
+    cl::desc("Write the net while it is being built, the complete basic blocks are released"
+             " right away (only the raw net is written, the other outputs are rejected)."));
+
+static cl::opt<bool> share_subnets(
+    "share-subnets",
+    cl::desc("Instantiate the plug-in nets of the same shape from a single shared copy"
+             " (the net does not change, only the memory of building it)."));
+
+static cl::opt<unsigned> format_jobs(
+    "format-jobs", cl::init(1),
+    cl::desc("Number of threads formatting the stored nets (the output does not depend on it)."));
+
+static cl::bits<cn::Reduction> reductions(
+    "reduce", cl::CommaSeparated,
+    cl::desc("Reduce the net by the given rules and store it besides the collapsed one:"),
+    cl::values(
+      clEnumValN(cn::Reduction::COLLAPSE, "collapse", "Fuse control flow chains"),
+      clEnumValN(cn::Reduction::PARALLEL_PATHS, "parallel-paths", "Remove redundant control flow paths"),
+      clEnumValN(cn::Reduction::SERIES_FUSION, "series-fusion", "Fuse transitions in series"),
+      clEnumValN(cn::Reduction::SELF_LOOPS, "self-loops", "Remove self-loops"),
+      clEnumValN(cn::Reduction::IDENTITY_TRANSITIONS, "identity-transitions", "Remove identity transitions"),
+      clEnumValN(cn::Reduction::DEAD_PLACES, "dead-places", "Remove dead places"),
+      clEnumValN(cn::Reduction::EQUIVALENT_PLACES, "equivalent-places", "Merge equivalent places")));
+
+// The streamed net is written only in the raw dot format and it is released
+// while it is being built, hence the other outputs cannot be produced. The
+// shared plug-in nets are allocated together, so they would not be released
+// with the streamed blocks.
+static void check_stream_options() {
+  if (!stream_net) {
+    return;
+  }
+  std::string conflicts;
+  for (const cl::Option *opt : std::initializer_list<const cl::Option *>{
+         &print_net_digest, &binary_net, &pnml_net, &reductions, &share_subnets}) {
+    if (opt->getNumOccurrences() > 0) {
+      conflicts += (conflicts.empty() ? " -" : ", -") + opt->ArgStr.str();
+    }
+  }
+  if (!conflicts.empty()) {
+    report_fatal_error(Twine("generate-mpn: -stream-net cannot be combined with") + conflicts, false);
+  }
+}
+
 PreservedAnalyses GenerateMPNetPass::run (Module &m, ModuleAnalysisManager &am) {
+  check_stream_options();
 
   am.registerPass([] { return MPILabellingAnalysis(); });
   am.registerPass([] { return MPIScopeAnalysis(); });
@@ -26,9 +99,30 @@ PreservedAnalyses GenerateMPNetPass::run (Module &m, ModuleAnalysisManager &am)
   Function *scope_fn = mpi_scope.getFunction();
   LoopInfo &loop_info = *mpi_scope.getLoopInfo();
 
+  // all the nets built below share the strings
+  cn::SymbolTable::Scope symbols(std::make_shared<cn::SymbolTable>());
+
   // create the CN representing scope function and following the CFG structure
   cn::CFG_CN cfg_cn(*scope_fn, loop_info);
 
+  // NOTE: the streamed net is created before the plug-in nets,
+  //       otherwise it is created afterwards as it gets later IDs
+  // TODO: take rank/address value from the input code
+  std::optional<cn::AddressableCN> acn;
+
+  std::unique_ptr<std::ofstream> stream_file;
+  std::unique_ptr<cn::formats::DotStream> stream;
+  if (stream_net) {
+    acn.emplace(1);
+    stream_file = std::make_unique<std::ofstream>("acn-" + std::to_string(acn->get_id()) + ".dot");
+    stream = std::make_unique<cn::formats::DotStream>(*stream_file, *acn);
+  }
+
+  std::unique_ptr<cn::SubnetTable> subnets;
+  if (share_subnets) {
+    subnets = std::make_unique<cn::SubnetTable>();
+  }
+
   // for each basic block in CFG_CN add a pcn if possible
   for (cn::BasicBlockCN &bbcn : cfg_cn.bb_cns) {
     // plug-in nets for all MPI calls
@@ -36,32 +130,92 @@ PreservedAnalyses GenerateMPNetPass::run (Module &m, ModuleAnalysisManager &am)
     while (!checkpoints.empty()) {
       auto checkpoint = checkpoints.front();
       if (checkpoint.second == MPICallType::DIRECT) { // TODO: first solve direct calls
-        bbcn.add_pcn(cn::createCommSubnet(checkpoint.first));
+        bbcn.add_pcn(cn::createCommSubnet(checkpoint.first, subnets.get()));
         checkpoints.pop();
       }
     }
     // enclose the basic block cn
     bbcn.enclose();
+
+    if (stream) {
+      cn::CommunicationNet part;
+      std::move(bbcn).inject_into(*acn, part);
+      stream->write(std::move(part));
+    }
   }
 
-  // TODO: take rank/address value from the input code
-  cn::AddressableCN acn(1);
-  std::move(cfg_cn).inject_into(acn);
+  if (subnets) {
+    errs() << "shared subnets: " << subnets->instances_size() << " nets of "
+           << subnets->shapes_size() << " shapes\n";
+  }
+
+  if (stream) {
+    // the basic blocks are already injected
+    cfg_cn.bb_cns.clear();
+    for (cn::CommunicationNet &part : stream->take_pending()) {
+      acn->takeover(std::move(part));
+    }
+  } else {
+    acn.emplace(1);
+  }
+  std::move(cfg_cn).inject_into(*acn);
   // resolve unresolved elements
-  acn.embedded_cn.resolve_unresolved();
+  acn->embedded_cn.resolve_unresolved();
   // enclose the cn
-  acn.enclose();
+  acn->enclose();
 
+  if (stream) {
+    stream->close(*acn);
+    return PreservedAnalyses::none();
+  }
+
+
+  if (print_net_digest) {
+    outs() << "net-digest " << cn::NetShape(*acn).digest() << "\n";
+  }
 
-  std::ofstream dot;
-  dot.open("acn-" + acn.get_id() + ".dot");
-  dot << acn;
-  dot.close();
+  // NOTE: The raw and reduced views of the net are written from its frozen
+  //       snapshot, the reduced one from a copy thawed from the snapshot.
+  //       The snapshot is released before the net itself is collapsed.
+  cn::ReductionRules rules(reductions.getBits());
+  {
+    const cn::FrozenNet raw(*acn);
+    std::ofstream dot;
+    dot.open("acn-" + std::to_string(raw.get_id()) + ".dot");
+    cn::formats::ShardedWriter(cn::formats::DotGraph(), format_jobs).write(dot, raw);
+    dot.close();
+
+    if (binary_net) {
+      std::ofstream bin("acn-" + std::to_string(raw.get_id()) + ".mpn", std::ios::binary);
+      raw_os_ostream os(bin);
+      cn::write_binary(os, raw);
+    }
+
+    if (pnml_net) {
+      std::ofstream pnml("acn-" + std::to_string(raw.get_id()) + ".pnml");
+      cn::formats::ShardedWriter(cn::formats::Pnml(), format_jobs).write(pnml, raw);
+    }
+
+    if (!rules.empty()) {
+      cn::AddressableCN reduced = raw.thaw();
+      std::ostringstream stats;
+      stats << reduced.reduce(rules);
+      errs() << stats.str();
+
+      std::ofstream dot3;
+      dot3.open("acn-" + std::to_string(raw.get_id()) + "-reduced.dot");
+      cn::formats::DotGraph().format(dot3, reduced);
+      dot3.close();
+    }
+  }
 
-  acn.collapse();
+  // NOTE: the memory of the elements removed by the collapse is not returned
+  //       (see NetArena), the net is not compacted as it is released right
+  //       after it is written
+  acn->collapse();
   std::ofstream dot2;
-  dot2.open("acn-" + acn.get_id() + "-collapsed.dot");
-  dot2 << acn;
+  dot2.open("acn-" + std::to_string(acn->get_id()) + "-collapsed.dot");
+  cn::formats::DotGraph().format(dot2, *acn);
   dot2.close();
 
   return PreservedAnalyses::none(); // TODO: check which analyses have been broken?
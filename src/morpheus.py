@@ -1,5 +1,9 @@
+import hashlib
+import json
 import os
+import shutil
 import sys
+import tempfile
 
 import click
 from plumbum import local#, BG
@@ -7,8 +11,11 @@ from plumbum import local#, BG
 @click.command()
 @click.argument("source-file")
 @click.option("-np", "--nproc", default=1, help="Number of processes.")
-@click.option("-o", "--output-file", default=None, type=str, help="Output file")
-def generate_mpn(source_file, nproc, output_file):
+@click.option("-o", "--output-file", default=None, type=str,
+              help="Output file with the map of ranks to their nets (stdout by default).")
+@click.option("--print-ir", is_flag=True, default=False,
+              help="Print the pruned IR of each rank to stdout.")
+def generate_mpn(source_file, nproc, output_file, print_ir):
     assert ("LLVM_ROOT_PATH" in os.environ), "LLVM_ROOT_PATH is not specified."
 
     cwd = os.path.abspath(os.getcwd())
@@ -41,8 +48,22 @@ def generate_mpn(source_file, nproc, output_file):
 
     opt_tool = "{}/opt".format(llvm_bin)
 
+    # NOTE: the source is compiled only once, the ranks differ by the pruning
+    source_ir = ll()
+
+    # Most of the ranks of an SPMD program end up with the same net (e.g. all
+    # the ranks but the root one). The ranks are split into classes by the
+    # structure of their nets and only one net is kept for each class.
+    #
+    # NOTE: The nets are matched by the digests of their canonical shapes
+    #       (see NetShape). The nets of a symmetric structure may be ordered
+    #       differently, then the equal nets remain in separate classes.
+    classes = []      # [{"digest": .., "ranks": [..], "dir": ..}]
+    net_classes = {}  # digest of net -> index of its class
+    ir_classes = {}   # digest of pruned IR -> index of its class
+    rank_classes = {}
+
     # TODO: set LD_LIBRARY_PATH for libMorph.so .. assert this
-    processes = []
     for p in range(nproc):
         with local.cwd(cwd):
             a = local[opt_tool][
@@ -62,8 +83,65 @@ def generate_mpn(source_file, nproc, output_file):
             ]
 
             # cmd = (ll | a) & BG(stderr=sys.stderr)# | b
-            cmd = ll | a | b
-            print(cmd())
+            cmd = (a << source_ir) | b
+            rank_ir = cmd()
+
+        if print_ir:
+            print(rank_ir)
+
+        # the same pruned code generates the same net
+        ir_digest = hashlib.sha256(rank_ir.encode()).hexdigest()
+        if ir_digest in ir_classes:
+            rank_classes[p] = ir_classes[ir_digest]
+            classes[rank_classes[p]]["ranks"].append(p)
+            continue
+
+        # NOTE: the pass writes the net files into its working directory
+        net_dir = tempfile.mkdtemp(prefix="mpn-", dir=cwd)
+        with local.cwd(net_dir):
+            c = local[opt_tool][
+                "-disable-output",
+                "--load", lib_morph,
+                "--load-pass-plugin", lib_morph,
+                "-passes", "generate-mpn",
+                "-print-net-digest",              # print digest of the shape of the net
+                "-binary-net"                     # store the net of the class
+            ]
+            net_digest = parse_net_digest((c << rank_ir)())
+
+        net_class = net_classes.get(net_digest)
+        if net_class is not None:
+            # an equal net has been already generated for another rank
+            shutil.rmtree(net_dir)
+        else:
+            net_class = len(classes)
+            net_classes[net_digest] = net_class
+            class_dir = os.path.join(cwd, "mpn-{}".format(net_class))
+            if os.path.exists(class_dir):
+                shutil.rmtree(class_dir)
+            os.rename(net_dir, class_dir)
+            classes.append({"digest": net_digest, "ranks": [], "dir": class_dir})
+
+        rank_classes[p] = ir_classes[ir_digest] = net_class
+        classes[rank_classes[p]]["ranks"].append(p)
+
+    ranks_map = {
+        "classes": classes,
+        "ranks": [rank_classes[p] for p in range(nproc)],  # rank -> index of its class
+    }
+    if output_file:
+        with open(output_file, "w") as f:
+            json.dump(ranks_map, f, indent=2)
+    else:
+        json.dump(ranks_map, sys.stdout, indent=2)
+        print()
+
+
+def parse_net_digest(output):
+    for line in output.splitlines():
+        if line.startswith("net-digest "):
+            return line.split()[1]
+    assert False, "The digest of the net is missing in the output of generate-mpn."
 
 
 if __name__ == "__main__":
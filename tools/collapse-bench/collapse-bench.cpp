@@ -0,0 +1,159 @@
+
+//===----------------------------------------------------------------------===//
+//
+// collapse-bench
+//
+// Measures the collapse of synthetic nets of the given sizes. The nets look
+// like the raw nets of GenerateMPNet: a chain of basic blocks, each of them
+// with a few plug-in nets of MPI calls joined by control flow places, and
+// an occasional branch skipping a block. The time of the fusion of control
+// flow chains alone (`-reduce=collapse`) and of the whole `collapse()` is
+// reported per element, so the scaling with the size of nets is visible.
+// The memory of the arena of each net is reported after it is built, after
+// the collapse and after the collapsed net is compacted, and the peak RSS
+// of the process at the end.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "morpheus/ADT/CommunicationNet.hpp"
+#include "morpheus/ADT/FrozenNet.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+using namespace llvm;
+
+static cl::list<unsigned> sizes(
+    "sizes", cl::CommaSeparated, cl::value_desc("N,..."),
+    cl::desc("Numbers of elements of the measured nets (default: 10^5 to 10^6)"));
+
+static cl::opt<unsigned> repeat(
+    "repeat", cl::init(3),
+    cl::desc("Number of runs of each measurement, the fastest one is reported"));
+
+static cl::opt<unsigned> calls(
+    "calls", cl::init(3),
+    cl::desc("Number of plug-in nets within each basic block"));
+
+// builds a net of at least `size` places and transitions
+static std::unique_ptr<cn::AddressableCN> make_net(size_t size) {
+  auto acn = std::make_unique<cn::AddressableCN>(1);
+  cn::CommunicationNet &net = acn->embedded_cn;
+
+  size_t elements = 0;
+  cn::Place *prev_exit = &acn->entry_place();
+  cn::Place *skipping = nullptr; // the exit of a block branching over the next one
+  for (size_t b = 0; elements < size; b++) {
+    std::string bb = std::to_string(b);
+    cn::Place &bb_entry = net.add_place("Unit", "", "entry bb" + bb);
+    net.add_cf_edge(*prev_exit, bb_entry);
+    if (skipping && skipping != prev_exit) {
+      net.add_cf_edge(*skipping, bb_entry);
+      skipping = nullptr;
+    }
+    elements++;
+
+    cn::Place *last = &bb_entry;
+    for (unsigned c = 0; c < calls; c++) {
+      std::string call = bb + "_" + std::to_string(c);
+      cn::Place &entry = net.add_place("Unit", "", "entry" + call);
+      cn::Place &params = net.add_place("(Int,Envelope)", "", "send" + call + "_params");
+      cn::Transition &send = net.add_transition({"size > 0"}, "send" + call);
+      cn::Transition &done = net.add_transition({}, "done" + call);
+      cn::Place &reqst = net.add_place("(MPI_Request,MessageRequest)", "", "send" + call + "_reqst");
+      cn::Place &exit = net.add_place("Unit", "", "exit" + call);
+      elements += 6;
+
+      net.add_cf_edge(*last, entry);
+      net.add_cf_edge(entry, send);
+      net.add_input_edge(params, send, "(data, {dest=1, tag=" + call + "})");
+      net.add_output_edge(send, reqst, "{id=" + call + "}");
+      net.add_output_edge(send, acn->asr, "{data=data}");
+      net.add_cf_edge(send, done);
+      net.add_cf_edge(done, exit);
+      last = &exit;
+    }
+
+    cn::Place &bb_exit = net.add_place("Unit", "", "exit bb" + bb);
+    net.add_cf_edge(*last, bb_exit);
+    elements++;
+    if (b % 8 == 7) {
+      skipping = &bb_exit;
+    }
+    prev_exit = &bb_exit;
+  }
+  net.add_cf_edge(*prev_exit, acn->exit_place());
+  return acn;
+}
+
+static double arena_mb(const cn::CommunicationNet &net) {
+  return net.arena()->bytes_allocated() / (1024.0 * 1024.0);
+}
+
+static size_t elements_size(const cn::CommunicationNet &net) {
+  return (std::distance(net.places().begin(), net.places().end()) +
+          std::distance(net.transitions().begin(), net.transitions().end()));
+}
+
+// the time of the fastest run of `fn` on a fresh net in milliseconds
+template <typename Fn>
+static double measure(size_t size, Fn fn) {
+  double best = std::numeric_limits<double>::max();
+  for (unsigned i = 0; i < std::max(unsigned(repeat), 1u); ++i) {
+    std::unique_ptr<cn::AddressableCN> acn = make_net(size);
+
+    auto begin = std::chrono::steady_clock::now();
+    fn(*acn);
+    auto end = std::chrono::steady_clock::now();
+
+    best = std::min(best, std::chrono::duration<double, std::milli>(end - begin).count());
+  }
+  return best;
+}
+
+int main(int argc, char **argv) {
+  cl::ParseCommandLineOptions(argc, argv, "Morpheus collapse benchmark\n");
+
+  std::vector<unsigned> measured(sizes.begin(), sizes.end());
+  if (measured.empty()) {
+    measured = {100000, 200000, 500000, 1000000};
+  }
+
+  for (unsigned size : measured) {
+    std::unique_ptr<cn::AddressableCN> acn = make_net(size);
+    size_t elements = elements_size(acn->embedded_cn);
+    double built_mb = arena_mb(*acn);
+    acn->collapse();
+    size_t collapsed = elements_size(acn->embedded_cn);
+    double collapsed_mb = arena_mb(*acn);
+    double compacted_mb = arena_mb(cn::compact(*acn));
+
+    double chains = measure(size, [](cn::AddressableCN &acn) {
+      acn.reduce(cn::ReductionRules().enable(cn::Reduction::COLLAPSE));
+    });
+    double whole = measure(size, [](cn::AddressableCN &acn) { acn.collapse(); });
+
+    outs() << format("%8zu elements -> %8zu   chains %9.2f ms %6.1f ns/elem   "
+                     "collapse() %9.2f ms %6.1f ns/elem\n",
+                     elements, collapsed, chains, 1e6 * chains / elements,
+                     whole, 1e6 * whole / elements);
+    outs() << format("         arena %8.1f MB   collapsed %8.1f MB   compacted %8.1f MB\n",
+                     built_mb, collapsed_mb, compacted_mb);
+  }
+
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  outs() << format("peak RSS %.1f MB\n", usage.ru_maxrss / 1024.0); // ru_maxrss is in KB
+  return 0;
+}
@@ -0,0 +1,120 @@
+
+//===----------------------------------------------------------------------===//
+//
+// format-bench
+//
+// Measures the formatters on a saved net (see `generate-mpn -binary-net`).
+// Each formatter prints the net through the Formatter interface, i.e. by a
+// virtual call per element, and by the concrete type of the formatter, whose
+// calls are resolved at compile time. The output is discarded, hence only
+// the formatting itself is measured.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "morpheus/ADT/BinaryNet.hpp"
+#include "morpheus/ADT/CommunicationNet.hpp"
+#include "morpheus/ADT/FrozenNet.hpp"
+#include "morpheus/Formats/DotGraph.hpp"
+#include "morpheus/Formats/PlainText.hpp"
+#include "morpheus/Formats/ShardedWriter.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <ostream>
+
+using namespace llvm;
+
+static cl::opt<std::string> input_file(
+    cl::Positional, cl::Required, cl::desc("<input net>"));
+
+static cl::opt<unsigned> repeat(
+    "repeat", cl::init(5),
+    cl::desc("Number of runs of each measurement, the fastest one is reported"));
+
+// discards the output, only its size is kept
+class NullOStream final : public raw_ostream {
+  uint64_t pos_ = 0;
+
+  void write_impl(const char *, size_t size) override { pos_ += size; }
+  uint64_t current_pos() const override { return pos_; }
+};
+
+// prints all the elements of the net one by one
+template <typename Fmt>
+static void print_elements(std::ostream &os, const cn::AddressableCN &acn, const Fmt &fmt) {
+  auto print_place = cn::formats::create_print_fn_<cn::Place>(os, fmt, "\n", 2);
+  auto print_transition = cn::formats::create_print_fn_<cn::Transition>(os, fmt, "\n", 2);
+  auto print_edge = cn::formats::create_print_fn_<cn::Edge>(os, fmt, "\n", 2);
+
+  auto print_net = [&](const cn::CommunicationNet &net) {
+    for (const auto &p : net.places()) {
+      print_place(p);
+      std::for_each(p->leads_to.begin(), p->leads_to.end(), print_edge);
+    }
+    for (const auto &t : net.transitions()) {
+      print_transition(t);
+      std::for_each(t->leads_to.begin(), t->leads_to.end(), print_edge);
+    }
+  };
+  print_net(acn);
+  print_net(acn.embedded_cn);
+}
+
+// the time of the fastest run of `fn` in milliseconds and the size of its output
+template <typename PrintFn>
+static std::pair<double, uint64_t> measure(PrintFn fn) {
+  double best = std::numeric_limits<double>::max();
+  uint64_t size = 0;
+  for (unsigned i = 0; i < std::max(unsigned(repeat), 1u); ++i) {
+    NullOStream null;
+    cn::formats::RawStreamBuf buf(null);
+    std::ostream os(&buf);
+
+    auto begin = std::chrono::steady_clock::now();
+    fn(os);
+    os.flush();
+    auto end = std::chrono::steady_clock::now();
+
+    best = std::min(best, std::chrono::duration<double, std::milli>(end - begin).count());
+    size = null.tell();
+  }
+  return {best, size};
+}
+
+template <typename Fmt>
+static void run(StringRef name, const cn::FrozenNet &net, const cn::AddressableCN &acn) {
+  Fmt fmt;
+  const cn::formats::Formatter &dyn_fmt = fmt;
+
+  auto report = [&](StringRef path, std::pair<double, uint64_t> dyn, std::pair<double, uint64_t> st) {
+    outs() << format("%-6s %-9s virtual %9.2f ms   static %9.2f ms   %5.2fx   %llu B\n",
+                     name.str().c_str(), path.str().c_str(), dyn.first, st.first,
+                     dyn.first / std::max(st.first, 1e-9), (unsigned long long) st.second);
+  };
+
+  report("elements",
+         measure([&](std::ostream &os) { print_elements(os, acn, dyn_fmt); }),
+         measure([&](std::ostream &os) { print_elements(os, acn, fmt); }));
+  report("snapshot",
+         measure([&](std::ostream &os) { cn::formats::ShardedWriter<>(dyn_fmt, 1).write(os, net); }),
+         measure([&](std::ostream &os) { cn::formats::ShardedWriter(fmt, 1).write(os, net); }));
+}
+
+int main(int argc, char **argv) {
+  cl::ParseCommandLineOptions(argc, argv, "Morpheus formatter benchmark\n");
+
+  Expected<cn::FrozenNet> net = cn::read_binary_file(input_file);
+  if (!net) {
+    errs() << "format-bench: " << input_file << ": " << toString(net.takeError()) << "\n";
+    return 1;
+  }
+  cn::AddressableCN acn = net->thaw();
+
+  run<cn::formats::DotGraph>("dot", *net, acn);
+  run<cn::formats::PlainText>("text", *net, acn);
+  return 0;
+}
@@ -0,0 +1,148 @@
+
+//===----------------------------------------------------------------------===//
+//
+// morph-net
+//
+// Post-processes the nets saved by `generate-mpn -binary-net`, i.e. collapses
+// or reduces them and converts them into the other formats, without
+// rebuilding them from IR. It also compares the structure of two saved nets
+// (see NetShape), e.g. to check that two ranks generate the same net.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "morpheus/ADT/BinaryNet.hpp"
+#include "morpheus/ADT/CommunicationNet.hpp"
+#include "morpheus/ADT/FrozenNet.hpp"
+#include "morpheus/ADT/NetShape.hpp"
+#include "morpheus/Formats/DotGraph.hpp"
+#include "morpheus/Formats/PlainText.hpp"
+#include "morpheus/Formats/Pnml.hpp"
+#include "morpheus/Formats/ShardedWriter.hpp"
+
+#include <ostream>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+using namespace llvm;
+
+enum struct OutputFormat {
+  DOT,
+  TEXT,
+  PNML,
+  BINARY,
+};
+
+static cl::opt<std::string> input_file(
+    cl::Positional, cl::Required, cl::desc("<input net>"));
+
+static cl::opt<std::string> output_file(
+    "o", cl::init("-"), cl::value_desc("filename"),
+    cl::desc("Output file (default: stdout)"));
+
+static cl::opt<OutputFormat> output_format(
+    "format", cl::init(OutputFormat::DOT), cl::desc("Format of the output net:"),
+    cl::values(
+      clEnumValN(OutputFormat::DOT, "dot", "Graphviz"),
+      clEnumValN(OutputFormat::TEXT, "text", "Plain text"),
+      clEnumValN(OutputFormat::PNML, "pnml", "PNML (high-level net)"),
+      clEnumValN(OutputFormat::BINARY, "binary", "Binary net (see BinaryNet.hpp)")));
+
+static cl::opt<unsigned> jobs(
+    "j", cl::init(std::thread::hardware_concurrency()), cl::value_desc("N"),
+    cl::desc("Number of threads formatting the output (default: all cores)"));
+
+static cl::opt<bool> collapse(
+    "collapse", cl::desc("Collapse the net the same way as generate-mpn does"));
+
+static cl::bits<cn::Reduction> reductions(
+    "reduce", cl::CommaSeparated,
+    cl::desc("Reduce the net by the given rules (after the collapse, if any):"),
+    cl::values(
+      clEnumValN(cn::Reduction::COLLAPSE, "collapse", "Fuse control flow chains"),
+      clEnumValN(cn::Reduction::PARALLEL_PATHS, "parallel-paths", "Remove redundant control flow paths"),
+      clEnumValN(cn::Reduction::SERIES_FUSION, "series-fusion", "Fuse transitions in series"),
+      clEnumValN(cn::Reduction::SELF_LOOPS, "self-loops", "Remove self-loops"),
+      clEnumValN(cn::Reduction::IDENTITY_TRANSITIONS, "identity-transitions", "Remove identity transitions"),
+      clEnumValN(cn::Reduction::DEAD_PLACES, "dead-places", "Remove dead places"),
+      clEnumValN(cn::Reduction::EQUIVALENT_PLACES, "equivalent-places", "Merge equivalent places")));
+
+static cl::opt<std::string> same_shape_as(
+    "same-shape-as", cl::value_desc("filename"),
+    cl::desc("Print `same-shape 1` if the input net has the same structure as "
+             "the given one (see NetShape), `same-shape 0` otherwise"));
+
+static void write_net(raw_ostream &os, const cn::FrozenNet &net) {
+  if (output_format == OutputFormat::BINARY) {
+    cn::write_binary(os, net);
+    return;
+  }
+
+  // NOTE: the formatters write straight into the buffer of `os`
+  cn::formats::RawStreamBuf buf(os);
+  std::ostream out(&buf);
+  switch (output_format) {
+    case OutputFormat::DOT:
+      cn::formats::ShardedWriter(cn::formats::DotGraph(), jobs).write(out, net);
+      break;
+    case OutputFormat::TEXT:
+      cn::formats::ShardedWriter(cn::formats::PlainText(), jobs).write(out, net);
+      break;
+    case OutputFormat::PNML:
+      cn::formats::ShardedWriter(cn::formats::Pnml(), jobs).write(out, net);
+      break;
+    case OutputFormat::BINARY: // written above
+      break;
+  }
+}
+
+int main(int argc, char **argv) {
+  cl::ParseCommandLineOptions(argc, argv, "Morpheus net post-processing\n");
+
+  Expected<cn::FrozenNet> loaded = cn::read_binary_file(input_file);
+  if (!loaded) {
+    errs() << "morph-net: " << input_file << ": " << toString(loaded.takeError()) << "\n";
+    return 1;
+  }
+
+  if (!same_shape_as.empty()) {
+    Expected<cn::FrozenNet> other = cn::read_binary_file(same_shape_as);
+    if (!other) {
+      errs() << "morph-net: " << same_shape_as << ": " << toString(other.takeError()) << "\n";
+      return 1;
+    }
+    // NOTE: the shapes are compared in full, the equal hashes are not enough
+    bool same = cn::NetShape(loaded->thaw()) == cn::NetShape(other->thaw());
+    outs() << "same-shape " << same << "\n";
+    return 0;
+  }
+
+  // NOTE: an unmodified net is written directly from the loaded snapshot
+  std::unique_ptr<cn::FrozenNet> modified;
+  cn::ReductionRules rules(reductions.getBits());
+  if (collapse || !rules.empty()) {
+    cn::AddressableCN acn = loaded->thaw();
+    if (collapse) {
+      acn.collapse();
+    }
+    if (!rules.empty()) {
+      std::ostringstream stats;
+      stats << acn.reduce(rules);
+      errs() << stats.str();
+    }
+    modified = std::make_unique<cn::FrozenNet>(acn);
+  }
+  const cn::FrozenNet &net = modified ? *modified : *loaded;
+
+  std::error_code ec;
+  raw_fd_ostream os(output_file, ec);
+  if (ec) {
+    errs() << "morph-net: " << output_file << ": " << ec.message() << "\n";
+    return 1;
+  }
+  write_net(os, net);
+  return 0;
+}